@@ -0,0 +1,49 @@
+#!/bin/sh
+# usage: count_instructions.sh file.s [tolerance_percent]
+#
+# Counts the instructions of every `reflected_*` and `handwritten_*` function
+# in a GCC/Clang assembly listing, including all functions they call (or tail
+# call) that are defined in the same listing. Fails if a reflected function
+# exceeds its hand-written counterpart by more than the tolerance (default 10%).
+
+awk -v tolerance="${2:-10}" '
+  /^[A-Za-z_.$][A-Za-z0-9_.$]*:/ {
+    label = substr($0, 1, index($0, ":") - 1)
+    if(label !~ /^\.L/) { fn = label; defined[fn] = 1 }
+    next
+  }
+  /^\t\.size/ { fn = ""; next }
+  fn != "" && /^\t[a-z]/ {
+    own[fn]++
+    if($1 ~ /^(call|jmp)/ && $2 !~ /^[.*%]/) {
+      target = $2
+      sub(/@PLT$/, "", target)
+      callees[fn] = callees[fn] " " target
+    }
+  }
+
+  function total(f, seen,    n, i, parts, sum) {
+    if(f in seen || !(f in defined)) return 0
+    seen[f] = 1
+    sum = own[f]
+    n = split(callees[f], parts, " ")
+    for(i=1; i<=n; ++i) sum += total(parts[i], seen)
+    return sum
+  }
+
+  END {
+    status = 0
+    printf "%-24s %10s %12s\n", "[instructions]", "reflected", "handwritten"
+    for(f in defined) {
+      if(f !~ /^reflected_/) continue
+      kernel = substr(f, length("reflected_") + 1)
+      split("", seen_r); split("", seen_h)
+      r = total(f, seen_r)
+      h = total("handwritten_" kernel, seen_h)
+      bad = (r * 100 > h * (100 + tolerance))
+      if(bad) status = 1
+      printf "%-24s %10d %12d%s\n", kernel, r, h, bad ? "  REGRESSION" : ""
+    }
+    exit status
+  }
+' "$1"
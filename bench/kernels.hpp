@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#include "structs.hpp"
+
+// Pairs of kernels: `reflected::f` goes through ecrypa, `handwritten::f`
+// spells out the members. Both must compute identical results.
+
+namespace bench::reflected {
+
+using ecrypa::operator==;
+
+template<class T>
+bool eq(const T& lhs, const T& rhs) { return lhs == rhs; }
+
+template<class T>
+std::uint64_t sum(const T& t) {
+  std::uint64_t h = 0;
+  ecrypa::each_item<T>([&] (auto bm) {
+    using Inner = std::decay_t<typename decltype(bm)::inner_type>;
+    if constexpr(ecrypa::is_annotated<Inner>{}) h = mix(h, sum(bm(t)));
+    else h = mix(h, bm(t));
+  });
+  return h;
+}
+
+template<class T>
+std::uint64_t serialize(T& t) {
+  checksum_archive ar;
+  ecrypa::serialize(ar, t);
+  return ar.sum;
+}
+
+template<class T>
+std::uint64_t read_by_name(const T& t, std::string_view name) {
+  return std::visit([&] (auto m) -> std::uint64_t {
+    if constexpr(std::is_same_v<decltype(m), std::monostate>) return 0;
+    else return mix(0, m(t));
+  }, ecrypa::get_accessor<T>(name));
+}
+
+}// bench::reflected
+
+namespace bench::handwritten {
+
+#define ECRYPA_BENCH_EQ(T, n) && lhs.n == rhs.n
+#define ECRYPA_BENCH_SUM(T, n) h = mix(h, t.n);
+#define ECRYPA_BENCH_NVP(T, n) , nvp<T>{#n, t.n}
+#define ECRYPA_BENCH_READ(T, n) if(name == #n) return mix(0, t.n);
+
+#define ECRYPA_BENCH_KERNELS(Name, LIST) \
+  inline bool eq(const Name& lhs, const Name& rhs) { \
+    return lhs.id == rhs.id LIST(ECRYPA_BENCH_EQ); \
+  } \
+  inline std::uint64_t sum(const Name& t) { \
+    std::uint64_t h = mix(0, t.id); \
+    LIST(ECRYPA_BENCH_SUM) \
+    return h; \
+  } \
+  inline std::uint64_t serialize(Name& t) { \
+    checksum_archive ar; \
+    ar(nvp<std::uint32_t>{"id", t.id} LIST(ECRYPA_BENCH_NVP)); \
+    return ar.sum; \
+  } \
+  inline std::uint64_t read_by_name(const Name& t, std::string_view name) { \
+    if(name == "id") return mix(0, t.id); \
+    LIST(ECRYPA_BENCH_READ) \
+    return 0; \
+  }
+
+ECRYPA_BENCH_KERNELS(W2, ECRYPA_BENCH_W2)
+ECRYPA_BENCH_KERNELS(W8, ECRYPA_BENCH_W8)
+ECRYPA_BENCH_KERNELS(W32, ECRYPA_BENCH_W32)
+ECRYPA_BENCH_KERNELS(Left, ECRYPA_BENCH_W2)
+ECRYPA_BENCH_KERNELS(Right, ECRYPA_BENCH_W2)
+
+inline bool eq(const Derived& lhs, const Derived& rhs) {
+  return eq(static_cast<const Left&>(lhs), static_cast<const Left&>(rhs))
+    && eq(static_cast<const Right&>(lhs), static_cast<const Right&>(rhs))
+    && lhs.d1 == rhs.d1
+    && lhs.d2 == rhs.d2;
+}
+inline std::uint64_t sum(const Derived& t) {
+  std::uint64_t h = mix(0, sum(static_cast<const Left&>(t)));
+  h = mix(h, sum(static_cast<const Right&>(t)));
+  h = mix(h, t.d1);
+  return mix(h, t.d2);
+}
+inline std::uint64_t serialize(Derived& t) {
+  checksum_archive ar;
+  ar(
+    nvp<Left>{"[public base]", t},
+    nvp<Right>{"[public base]", t},
+    nvp<std::int64_t>{"d1", t.d1},
+    nvp<double>{"d2", t.d2}
+  );
+  return ar.sum;
+}
+inline std::uint64_t read_by_name(const Derived& t, std::string_view name) {
+  if(name == "d1") return mix(0, t.d1);
+  if(name == "d2") return mix(0, t.d2);
+  return 0;
+}
+
+inline bool eq(const Refs& lhs, const Refs& rhs) {
+  return lhs.ra == rhs.ra && lhs.rb == rhs.rb && lhs.rc == rhs.rc;
+}
+inline std::uint64_t sum(const Refs& t) {
+  return mix(mix(mix(0, t.ra), t.rb), t.rc);
+}
+inline std::uint64_t serialize(Refs& t) {
+  checksum_archive ar;
+  ar(
+    nvp<std::int64_t>{"ra", t.ra},
+    nvp<double>{"rb", t.rb},
+    nvp<std::int32_t>{"rc", t.rc}
+  );
+  return ar.sum;
+}
+inline std::uint64_t read_by_name(const Refs& t, std::string_view name) {
+  if(name == "ra") return mix(0, t.ra);
+  if(name == "rb") return mix(0, t.rb);
+  if(name == "rc") return mix(0, t.rc);
+  return 0;
+}
+
+}// bench::handwritten
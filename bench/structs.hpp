@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <random>
+#include <string_view>
+#include <type_traits>
+
+#include <ecrypa/ecrypa.hpp>
+#include <ecrypa/v0/serialize.hpp>
+
+// Annotated test structs and their hand-written counterparts. Each member
+// list `X(type, name)` expands into the data members, the annotation and the
+// hand-written code, so both sides always see the same members.
+
+#define ECRYPA_BENCH_W2(X) \
+  X(std::int64_t, m1)
+
+#define ECRYPA_BENCH_W8(X) \
+  X(std::int64_t, m1) X(double, m2) X(std::int32_t, m3) X(std::uint8_t, m4) \
+  X(std::int64_t, m5) X(float, m6) X(std::uint16_t, m7)
+
+#define ECRYPA_BENCH_W32(X) \
+  ECRYPA_BENCH_W8(X) \
+  X(std::int64_t, m8) X(double, m9) X(std::int32_t, m10) X(std::uint8_t, m11) \
+  X(std::int64_t, m12) X(float, m13) X(std::uint16_t, m14) X(std::int64_t, m15)\
+  X(std::int64_t, m16) X(double, m17) X(std::int32_t, m18) X(std::int8_t, m19)\
+  X(std::int64_t, m20) X(float, m21) X(std::uint16_t, m22) X(std::int64_t, m23)\
+  X(std::int64_t, m24) X(double, m25) X(std::int32_t, m26) X(std::int8_t, m27)\
+  X(std::int64_t, m28) X(float, m29) X(std::uint16_t, m30) X(std::int64_t, m31)
+
+#define ECRYPA_BENCH_FIELD(T, n) T n{};
+#define ECRYPA_BENCH_ANNOTATION(T, n) , a(&Self::n, #n)
+
+// every struct starts with `id`, so the lists can prepend commas
+#define ECRYPA_BENCH_STRUCT(Name, LIST) \
+  struct Name { \
+    using Self = Name; \
+    std::uint32_t id{}; \
+    LIST(ECRYPA_BENCH_FIELD) \
+    template<class A> friend constexpr auto annotate(A a, Name*) { \
+      return a(a(&Self::id, "id") LIST(ECRYPA_BENCH_ANNOTATION)); \
+    } \
+  };
+
+namespace bench {
+
+ECRYPA_BENCH_STRUCT(W2, ECRYPA_BENCH_W2)
+ECRYPA_BENCH_STRUCT(W8, ECRYPA_BENCH_W8)
+ECRYPA_BENCH_STRUCT(W32, ECRYPA_BENCH_W32)
+
+////////////////////////////////////////////////////////////////////////////////
+
+// bases: two annotated bases plus own members
+ECRYPA_BENCH_STRUCT(Left, ECRYPA_BENCH_W2)
+ECRYPA_BENCH_STRUCT(Right, ECRYPA_BENCH_W2)
+
+struct Derived : Left, Right {
+  std::int64_t d1{};
+  double d2{};
+
+  template<class A> friend constexpr auto annotate(A a, Derived*) {
+    return a(
+      (Left*){},
+      (Right*){},
+      a(&Derived::d1, "d1"),
+      a(&Derived::d2, "d2")
+    );
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// reference members via `ref_member_impl`
+struct Refs {
+  std::int64_t a_{};
+  double b_{};
+  std::int32_t c_{};
+
+  const std::int64_t& ra = a_;
+  const double& rb = b_;
+  const std::int32_t& rc = c_;
+
+  template<class A> friend constexpr auto annotate(A a, Refs*) {
+    return a(
+      a([] (auto self) { return A::lref(self->ra); }, "ra"),
+      a([] (auto self) { return A::lref(self->rb); }, "rb"),
+      a([] (auto self) { return A::lref(self->rc); }, "rc")
+    );
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class T>
+std::uint64_t mix(std::uint64_t h, T t) {
+  if constexpr(std::is_floating_point_v<T>) {
+    using Bits =
+      std::conditional_t<sizeof(T) == 8, std::uint64_t, std::uint32_t>;
+    Bits bits;
+    std::memcpy(&bits, &t, sizeof(bits));
+    return h * 31 + bits;
+  }
+  else {
+    return h * 31 + static_cast<std::uint64_t>(t);
+  }
+}
+
+// opt into `ecrypa::serialize` for all structs above
+template<class T>
+auto use_ecrypa_serialization(T*) -> std::true_type;
+
+// `serialize` target: folds every value into a checksum
+struct checksum_archive {
+  std::uint64_t sum = 0;
+
+  template<class T>
+  static std::uint64_t add(std::uint64_t h, const T& t) {
+    if constexpr(ecrypa::is_annotated<T>{}) {
+      ecrypa::each_item<T>([&] (auto bm) { h = add(h, bm(t)); });
+      return h;
+    }
+    else {
+      return mix(h, t);
+    }
+  }
+
+// accumulate in a local: `sum` may alias the serialized members
+  template<class... Nvps>
+  void operator()(const Nvps&... nvps) {
+    std::uint64_t h = sum;
+    (..., (h = add(h, nvps.value)));
+    sum = h;
+  }
+};
+
+template<class T>
+struct nvp {
+  const char* name;
+  const T& value;
+};
+
+template<class T>
+nvp<std::decay_t<T>> make_nvp(
+  ecrypa::adl_tagged<const char*, checksum_archive> name,
+  T&& value
+) {
+  return {name, value};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// fills arithmetic members with random values, recursing into annotated
+// bases and members; reference members are left alone
+template<class Outer>
+void randomize(Outer& outer, std::mt19937_64& rng) {
+  if constexpr(ecrypa::is_annotated<Outer>{}) {
+    ecrypa::each_item<Outer>([&] (auto bm) {
+      using Inner = typename decltype(bm)::inner_type;
+      if constexpr(!std::is_reference_v<Inner>) randomize(bm(outer), rng);
+    });
+  }
+  else if constexpr(std::is_floating_point_v<Outer>) {
+    outer = std::uniform_real_distribution<Outer>{-1e6, 1e6}(rng);
+  }
+  else {
+    static_assert(std::is_integral_v<Outer>);
+    outer = static_cast<Outer>(rng());
+  }
+}
+
+inline void randomize(Refs& refs, std::mt19937_64& rng) {
+  randomize(refs.a_, rng);
+  randomize(refs.b_, rng);
+  randomize(refs.c_, rng);
+}
+
+}// bench
@@ -0,0 +1,135 @@
+// Runtime comparison of reflected and hand-written kernels (see kernels.hpp)
+// over random records. Prints ns per record and the reflected/hand-written
+// ratio; exits nonzero if any pair disagrees on its result.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "kernels.hpp"
+
+namespace {
+
+constexpr std::size_t record_count = 1 << 14;
+constexpr int repetitions = 200;
+
+template<class T>
+void keep(const T& t) { asm volatile("" : : "g"(&t) : "memory"); }
+
+template<class F>
+double ns_per_record(F&& f) {
+  auto best = std::chrono::nanoseconds::max();
+  for(int rep=0; rep<repetitions; ++rep) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::nanoseconds{stop - start});
+  }
+  return double(best.count()) / double(record_count);
+}
+
+bool all_agree = true;
+
+template<class Reflected, class Handwritten>
+void compare(const char* what, Reflected&& r, Handwritten&& h) {
+  std::uint64_t r_result = 0;
+  std::uint64_t h_result = 0;
+  double r_ns = ns_per_record([&] { keep(r_result = r()); });
+  double h_ns = ns_per_record([&] { keep(h_result = h()); });
+  bool agree = (r_result == h_result);
+  all_agree &= agree;
+  std::printf(
+    "%-24s %10.3f %10.3f %8.2f%s\n",
+    what, r_ns, h_ns, r_ns / h_ns, agree ? "" : "  RESULTS DIFFER"
+  );
+}
+
+template<class T>
+void run(const char* name, std::mt19937_64& rng) {
+  std::vector<T> lhs(record_count);
+  std::vector<T> rhs(record_count);
+  for(std::size_t i=0; i<record_count; ++i) {
+    // every other pair equal (same random state), so `==` cannot always bail
+    // out early; assignment is not an option for reference members
+    std::mt19937_64 replay = rng;
+    bench::randomize(lhs[i], rng);
+    bench::randomize(rhs[i], i % 2 ? rng : replay);
+  }
+
+  const std::string_view names[] = {"id", "m1", "d2", "rc", "missing"};
+
+  char label[64];
+  const auto row = [&] (const char* op) {
+    std::snprintf(label, sizeof(label), "%s %s", name, op);
+    return label;
+  };
+
+  compare(row("operator=="), [&] {
+    std::uint64_t n = 0;
+    for(std::size_t i=0; i<record_count; ++i) {
+      n += bench::reflected::eq(lhs[i], rhs[i]);
+    }
+    return n;
+  }, [&] {
+    std::uint64_t n = 0;
+    for(std::size_t i=0; i<record_count; ++i) {
+      n += bench::handwritten::eq(lhs[i], rhs[i]);
+    }
+    return n;
+  });
+
+  compare(row("each_item"), [&] {
+    std::uint64_t h = 0;
+    for(const T& t : lhs) h ^= bench::reflected::sum(t);
+    return h;
+  }, [&] {
+    std::uint64_t h = 0;
+    for(const T& t : lhs) h ^= bench::handwritten::sum(t);
+    return h;
+  });
+
+  compare(row("serialize"), [&] {
+    std::uint64_t h = 0;
+    for(T& t : lhs) h ^= bench::reflected::serialize(t);
+    return h;
+  }, [&] {
+    std::uint64_t h = 0;
+    for(T& t : lhs) h ^= bench::handwritten::serialize(t);
+    return h;
+  });
+
+  compare(row("get_accessor"), [&] {
+    std::uint64_t h = 0;
+    for(std::size_t i=0; i<record_count; ++i) {
+      h ^= bench::reflected::read_by_name(lhs[i], names[i % 5]);
+    }
+    return h;
+  }, [&] {
+    std::uint64_t h = 0;
+    for(std::size_t i=0; i<record_count; ++i) {
+      h ^= bench::handwritten::read_by_name(lhs[i], names[i % 5]);
+    }
+    return h;
+  });
+}
+
+}// namespace
+
+int main() {
+  std::mt19937_64 rng{42};
+
+  std::printf(
+    "%-24s %10s %10s %8s\n", "[ns/record]", "reflected", "handwritten", "ratio"
+  );
+  run<bench::W2>("W2", rng);
+  run<bench::W8>("W8", rng);
+  run<bench::W32>("W32", rng);
+  run<bench::Derived>("Derived", rng);
+  run<bench::Refs>("Refs", rng);
+
+  return all_agree ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+// Reflected and hand-written kernels as out-of-line functions, compiled to
+// assembly by `make check`. `count_instructions.sh` fails if any `reflected_*`
+// function has more than 10% more instructions than its `handwritten_*`
+// counterpart (the tolerance is its second argument).
+
+#include "kernels.hpp"
+
+#define ECRYPA_BENCH_PAIR(T) \
+  extern "C" bool reflected_eq_##T(const bench::T& l, const bench::T& r) \
+  { return bench::reflected::eq(l, r); } \
+  extern "C" bool handwritten_eq_##T(const bench::T& l, const bench::T& r) \
+  { return bench::handwritten::eq(l, r); } \
+  extern "C" std::uint64_t reflected_sum_##T(const bench::T& t) \
+  { return bench::reflected::sum(t); } \
+  extern "C" std::uint64_t handwritten_sum_##T(const bench::T& t) \
+  { return bench::handwritten::sum(t); } \
+  extern "C" std::uint64_t reflected_serialize_##T(bench::T& t) \
+  { return bench::reflected::serialize(t); } \
+  extern "C" std::uint64_t handwritten_serialize_##T(bench::T& t) \
+  { return bench::handwritten::serialize(t); }
+
+ECRYPA_BENCH_PAIR(W2)
+ECRYPA_BENCH_PAIR(W8)
+ECRYPA_BENCH_PAIR(W32)
+ECRYPA_BENCH_PAIR(Derived)
+ECRYPA_BENCH_PAIR(Refs)
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <ecrypa/detail/annotation_tuple.hpp>
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Per-thread access counters for the items of `Outer`. Only the owning thread
+// writes its block (plain load and store, no read-modify-write); the counters
+// are atomics so that `snapshot` may read them from any thread. Blocks of
+// exited threads are folded into `retired`.
+template<class Outer>
+class access_counts {
+ public:
+  static constexpr std::size_t size = annotation_tuple<Outer>::size;
+  using counts_type = std::array<std::uint64_t, size>;
+
+  template<std::size_t idx>
+  static void hit() {
+    std::atomic<std::uint64_t>& c = local_().counts[idx];
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  static counts_type snapshot() {
+    registry& reg = registry_();
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    counts_type ret = reg.retired;
+    for(const block* b : reg.live) {
+      for(std::size_t i=0; i<size; ++i) {
+        ret[i] += b->counts[i].load(std::memory_order_relaxed);
+      }
+    }
+    return ret;
+  }
+
+// races with concurrent `hit`s of other threads; meant for quiescent phases
+  static void reset() {
+    registry& reg = registry_();
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    reg.retired = {};
+    for(block* b : reg.live) {
+      for(auto& c : b->counts) c.store(0, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  struct block;
+
+  struct registry {
+    std::mutex mutex;
+    std::vector<block*> live;
+    counts_type retired{};
+  };
+
+  struct block {
+    std::array<std::atomic<std::uint64_t>, size> counts{};
+
+    block() {
+      registry& reg = registry_();
+      std::lock_guard<std::mutex> lock{reg.mutex};
+      reg.live.push_back(this);
+    }
+
+    ~block() {
+      registry& reg = registry_();
+      std::lock_guard<std::mutex> lock{reg.mutex};
+      for(std::size_t i=0; i<size; ++i) {
+        reg.retired[i] += counts[i].load(std::memory_order_relaxed);
+      }
+      reg.live.erase(std::find(reg.live.begin(), reg.live.end(), this));
+    }
+  };
+
+// function-local statics: constructed before the first block registers and
+// hence destroyed after the last block of the main thread is gone
+  static registry& registry_() {
+    static registry reg;
+    return reg;
+  }
+
+  static block& local_() {
+    thread_local block b;
+    return b;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
@@ -14,10 +14,28 @@
 #include <ecrypa/detail/panics.hpp>
 #include <ecrypa/detail/traits.hpp>
 
+#if defined(ECRYPA_COUNT_ITEM_ACCESS)
+#include <ecrypa/detail/access_counts.hpp>
+#endif
+
 namespace ecrypa::detail {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Instrumentation hook of the item call operators. Define
+// `ECRYPA_COUNT_ITEM_ACCESS` consistently for all translation units to count
+// accesses per item (see `ecrypa/v0/access_counts.hpp`); otherwise a no-op.
+template<std::size_t idx, class Outer>
+constexpr void count_access() {
+#if defined(ECRYPA_COUNT_ITEM_ACCESS)
+  if(!__builtin_is_constant_evaluated()) {
+    access_counts<Outer>::template hit<idx>();
+  }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 template<
   std::size_t idx,
   class Outer,
@@ -52,15 +70,19 @@ class base_impl {
   }
 
   constexpr Base& operator()(Derived& derived) const {
+    count_access<idx, Derived>();
     return (Base&)derived;// must use c-style cast (bypasses access specifier)
   }
   constexpr const Base& operator()(const Derived& derived) const {
+    count_access<idx, Derived>();
     return (const Base&)derived;// dito c-style cast
   }
   constexpr Base&& operator()(Derived&& derived) const {
+    count_access<idx, Derived>();
     return (Base&&)derived;// dito c-style cast
   }
   constexpr const Base&& operator()(const Derived&& derived) const {
+    count_access<idx, Derived>();
     return (const Base&&)derived;// dito c-style cast
   }
 
@@ -90,15 +112,19 @@ class nonref_member_impl {
   }
 
   constexpr inner_type& operator()(Outer& s) const {
+    count_access<idx, Outer>();
     return s.*member_obj_ptr();
   }
   constexpr const inner_type& operator()(const Outer& s) const {
+    count_access<idx, Outer>();
     return s.*member_obj_ptr();
   }
   constexpr inner_type&& operator()(Outer&& s) const {
+    count_access<idx, Outer>();
     return std::move(s).*member_obj_ptr();
   }
   constexpr const inner_type&& operator()(const Outer&& s) const {
+    count_access<idx, Outer>();
     return std::move(s).*member_obj_ptr();
   }
 
@@ -125,6 +151,7 @@ struct ref_member_impl {
   static constexpr const char* inner_name() { return ref_annotation.name; }
 
   constexpr inner_type operator()(const Outer& self) const {
+    count_access<idx, Outer>();
     return static_cast<inner_type>( ref_annotation(std::addressof(self)).ref );
   }
 
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
+#include <string_view>
 #include <type_traits>
 #include <utility>
 
@@ -15,4 +17,23 @@ constexpr auto incr_inds_by(
   return std::index_sequence<(inds + offset)...>{};
 }
 
+// FNV-1a; used for layout fingerprints, so it must stay stable
+constexpr std::uint64_t fnv1a_init = 0xcbf29ce484222325ull;
+
+constexpr std::uint64_t fnv1a(std::string_view sv, std::uint64_t h=fnv1a_init) {
+  for(char c : sv) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+constexpr std::uint64_t fnv1a(std::uint64_t v, std::uint64_t h=fnv1a_init) {
+  for(int i=0; i<8; ++i) {
+    h ^= (v >> (8*i)) & 0xff;
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
 }// ecrypa::detail
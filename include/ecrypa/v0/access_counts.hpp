@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <ostream>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/detail/access_counts.hpp>
+
+// Access counts of item handles, for profile-driven hot/cold member ordering.
+// Counting happens only if `ECRYPA_COUNT_ITEM_ACCESS` is defined for all
+// translation units; otherwise all counts stay zero.
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct item_access_count {
+  std::size_t idx;
+  const char* name;
+  std::uint64_t count;
+};
+
+// summed over all threads, in annotation order
+template<class Outer>
+auto access_counts() {
+  const auto counts = detail::access_counts<Outer>::snapshot();
+  return apply_items<Outer>([&] (auto... bms) {
+    return std::array<item_access_count, sizeof...(bms)>{
+      item_access_count{bms.idx, bms.inner_name(), counts[bms.idx]}...
+    };
+  });
+}
+
+template<class Outer>
+void reset_access_counts() {
+  detail::access_counts<Outer>::reset();
+}
+
+// hotness table, hottest item first
+template<class Outer>
+std::ostream& dump_access_counts(std::ostream& os) {
+  auto counts = access_counts<Outer>();
+  std::stable_sort(counts.begin(), counts.end(), [] (auto& lhs, auto& rhs) {
+    return lhs.count > rhs.count;
+  });
+
+  std::uint64_t total = 0;
+  for(const item_access_count& c : counts) total += c.count;
+
+  os << "=== " << type_name<Outer>() << " (" << total << " accesses) ===\n";
+  for(const item_access_count& c : counts) {
+    double percent = total ? 100.0 * double(c.count) / double(total) : 0.0;
+    os << std::setw(4) << c.idx << "  "
+       << std::setw(14) << c.count << "  "
+       << std::fixed << std::setprecision(1) << std::setw(5) << percent << "%  "
+       << c.name << '\n';
+  }
+  return os;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
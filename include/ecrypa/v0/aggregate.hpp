@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/layout.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Aggregates for `aggregate`, e.g. `sum_of{item<2, Order>{}}`. Each provides
+// `result_type`, an `identity()` and `combine(result, value)`; `combine` must
+// be associative, since blocks are reduced in several lanes.
+
+template<class T>
+using sum_type_t = std::conditional_t<
+  std::is_floating_point_v<T>,
+  double,
+  std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>
+>;
+
+template<class Item>
+struct sum_of {
+  using item_type = Item;
+  using value_type = std::decay_t<typename Item::inner_type>;
+  using result_type = sum_type_t<value_type>;
+
+  static_assert(std::is_arithmetic_v<value_type>, "sum_of: not arithmetic");
+
+  constexpr explicit sum_of(Item) {}
+
+  static constexpr result_type identity() { return 0; }
+  template<class V>
+  static constexpr result_type combine(result_type r, V v) {
+    return r + result_type(v);
+  }
+};
+
+template<class Item>
+struct min_of {
+  using item_type = Item;
+  using value_type = std::decay_t<typename Item::inner_type>;
+  using result_type = value_type;
+
+  static_assert(std::is_arithmetic_v<value_type>, "min_of: not arithmetic");
+
+  constexpr explicit min_of(Item) {}
+
+  static constexpr result_type identity() {
+    return std::numeric_limits<result_type>::max();
+  }
+  static constexpr result_type combine(result_type r, result_type v) {
+    return v < r ? v : r;
+  }
+};
+
+template<class Item>
+struct max_of {
+  using item_type = Item;
+  using value_type = std::decay_t<typename Item::inner_type>;
+  using result_type = value_type;
+
+  static_assert(std::is_arithmetic_v<value_type>, "max_of: not arithmetic");
+
+  constexpr explicit max_of(Item) {}
+
+  static constexpr result_type identity() {
+    return std::numeric_limits<result_type>::lowest();
+  }
+  static constexpr result_type combine(result_type r, result_type v) {
+    return r < v ? v : r;
+  }
+};
+
+// number of records per group
+struct count_of {
+  using result_type = std::uint64_t;
+
+  static constexpr result_type identity() { return 0; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class Key, class... Aggregates>
+using aggregate_result = std::vector<
+  std::pair<Key, std::tuple<typename Aggregates::result_type...>>
+>;
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+constexpr std::size_t aggregate_block = 256;
+constexpr std::size_t aggregate_lanes = 8;
+
+// Maps group keys to consecutive group ids `0, 1, ...`; the last key is
+// cached, since consecutive records often share their group.
+template<class Key, class ExpressionSfinae = void>
+class group_index {
+ public:
+  std::uint32_t find_or_add(const Key& key) {
+    if(last_ && key == *last_) return last_group_;
+    auto [it, inserted] = map_.try_emplace(key, std::uint32_t(keys_.size()));
+    if(inserted) keys_.push_back(&it->first);
+    last_ = &it->first;
+    last_group_ = it->second;
+    return last_group_;
+  }
+
+  std::size_t size() const { return keys_.size(); }
+  const Key& key(std::size_t group) const { return *keys_[group]; }
+
+ private:
+  std::unordered_map<Key, std::uint32_t> map_;
+  std::vector<const Key*> keys_;
+  const Key* last_ = nullptr;
+  std::uint32_t last_group_ = 0;
+};
+
+// unsigned type indexing the dense table of `group_index`
+template<class Key>
+struct dense_group_key { using type = std::make_unsigned_t<Key>; };
+
+template<>
+struct dense_group_key<bool> { using type = unsigned char; };
+
+// small non-negative integral keys index a dense table directly
+template<class Key>
+class group_index<Key, std::enable_if_t<std::is_integral_v<Key>>> {
+ public:
+  std::uint32_t find_or_add(Key key) {
+    auto u = static_cast<typename dense_group_key<Key>::type>(key);
+    std::uint32_t* slot;
+    if(u < dense_limit) {
+      if(u >= dense_.size()) dense_.resize(std::size_t(u) + 1);
+      slot = &dense_[u];
+    }
+    else {
+      slot = &sparse_[key];
+    }
+    if(!*slot) {
+      *slot = std::uint32_t(keys_.size()) + 1;
+      keys_.push_back(key);
+    }
+    return *slot - 1;
+  }
+
+  std::size_t size() const { return keys_.size(); }
+  Key key(std::size_t group) const { return keys_[group]; }
+
+ private:
+  static constexpr std::size_t dense_limit = 1 << 16;
+
+// group id + 1, or 0 for keys not seen yet
+  std::vector<std::uint32_t> dense_;
+  std::unordered_map<Key, std::uint32_t> sparse_;
+  std::vector<Key> keys_;
+};
+
+// reduces `n` values, in independent lanes so the loop vectorizes
+template<class Aggregate, class V>
+typename Aggregate::result_type reduce_block(const V* values, std::size_t n) {
+  using R = typename Aggregate::result_type;
+  R lanes[aggregate_lanes];
+  std::fill_n(lanes, aggregate_lanes, Aggregate::identity());
+  for(std::size_t j=0; j<n; ++j) {
+    lanes[j % aggregate_lanes] =
+      Aggregate::combine(lanes[j % aggregate_lanes], values[j]);
+  }
+  R r = lanes[0];
+  for(std::size_t l=1; l<aggregate_lanes; ++l) {
+    r = Aggregate::combine(r, lanes[l]);
+  }
+  return r;
+}
+
+// folds a block of records into the per-group results `rs`; `uniform` means
+// all records of the block belong to group `groups[0]`
+template<class Aggregate, class Outer, class R>
+void accumulate_block(
+  const Outer* first,
+  std::size_t n,
+  const std::uint32_t* groups,
+  bool uniform,
+  std::vector<R>& rs
+) {
+  if constexpr(std::is_same_v<Aggregate, count_of>) {
+    if(uniform) rs[groups[0]] += n;
+    else for(std::size_t j=0; j<n; ++j) ++rs[groups[j]];
+  }
+  else {
+    typename Aggregate::value_type values[aggregate_block];
+    gather(typename Aggregate::item_type{}, first, n, values);
+    if(uniform) {
+      // full blocks get a constant trip count, which is what vectorizes
+      auto r = n == aggregate_block
+        ? reduce_block<Aggregate>(values, aggregate_block)
+        : reduce_block<Aggregate>(values, n);
+      rs[groups[0]] = Aggregate::combine(rs[groups[0]], r);
+    }
+    else {
+      for(std::size_t j=0; j<n; ++j) {
+        rs[groups[j]] = Aggregate::combine(rs[groups[j]], values[j]);
+      }
+    }
+  }
+}
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Groups a contiguous range of `Outer` records by the member `group` and
+// computes `aggregates` per group, in order of first appearance:
+// ```
+// auto rows = ecrypa::aggregate<Order>(
+//   orders,
+//   ecrypa::item<1, Order>{},             // group by symbol
+//   ecrypa::sum_of{ecrypa::item<2, Order>{}},
+//   ecrypa::max_of{ecrypa::item<3, Order>{}},
+//   ecrypa::count_of{}
+// );
+// for(auto& [symbol, values] : rows) { auto [qty, last, n] = values; ... }
+// ```
+// Records are processed in blocks; blocks that fall into a single group
+// (e.g. in data clustered by the group key) are reduced without scatter.
+template<class Outer, class Range, class Group, class... Aggregates>
+auto aggregate(const Range& records, Group, Aggregates...)
+  -> aggregate_result<std::decay_t<typename Group::inner_type>, Aggregates...>
+{
+  static_assert(
+    std::is_same_v<typename Group::outer_type, Outer>,
+    "aggregate: `group` must be a member handle of `Outer`"
+  );
+  using Key = std::decay_t<typename Group::inner_type>;
+  using detail::aggregate_block;
+
+  const Outer* data = std::data(records);
+  const std::size_t size = std::size(records);
+
+  detail::group_index<Key> index;
+  std::size_t group_count = 0;
+  std::tuple<std::vector<typename Aggregates::result_type>...> results;
+  std::uint32_t groups[aggregate_block];
+
+  for(std::size_t i=0; i<size; i+=aggregate_block) {
+    const Outer* first = data + i;
+    const std::size_t n = std::min(aggregate_block, size - i);
+
+    bool uniform = true;
+    if constexpr(std::is_arithmetic_v<Key>) {
+      // one lookup for blocks of a single key
+      Key keys[aggregate_block];
+      gather(Group{}, first, n, keys);
+      for(std::size_t j=0; j<n; ++j) uniform &= (keys[j] == keys[0]);
+      if(uniform) {
+        groups[0] = index.find_or_add(keys[0]);
+      }
+      else {
+        for(std::size_t j=0; j<n; ++j) groups[j] = index.find_or_add(keys[j]);
+      }
+    }
+    else {
+      for(std::size_t j=0; j<n; ++j) {
+        groups[j] = index.find_or_add(Group{}(first[j]));
+        uniform &= (groups[j] == groups[0]);
+      }
+    }
+    if(index.size() > group_count) {
+      group_count = index.size();
+      std::apply([&] (auto&... rs) {
+        (..., rs.resize(group_count, Aggregates::identity()));
+      }, results);
+    }
+
+    std::apply([&] (auto&... rs) {
+      (..., detail::accumulate_block<Aggregates>(
+        first, n, groups, uniform, rs
+      ));
+    }, results);
+  }
+
+  aggregate_result<Key, Aggregates...> ret;
+  ret.reserve(index.size());
+  for(std::size_t g=0; g<index.size(); ++g) {
+    ret.emplace_back(index.key(g), std::apply([&] (auto&... rs) {
+      return std::make_tuple(rs[g]...);
+    }, results));
+  }
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
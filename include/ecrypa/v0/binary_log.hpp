@@ -0,0 +1,408 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/layout.hpp>
+#include <ecrypa/v0/names.hpp>
+#include <ecrypa/v0/traits.hpp>
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class T>
+struct is_std_array : std::false_type {};
+
+template<class T, std::size_t N>
+struct is_std_array<std::array<T, N>> : std::true_type {};
+
+template<class T>
+void format_log_value(std::string& out, const T& t);
+
+template<class Outer>
+void format_log_object(std::string& out, const Outer& outer) {
+  out += ::ecrypa::type_name<Outer>();
+  out.push_back('{');
+  bool first = true;
+  each_item<Outer>([&] (auto bm) {
+    if(!first) out += ", ";
+    first = false;
+    if constexpr(decltype(bm)::is_member) {
+      out += bm.inner_name();
+      out.push_back('=');
+    }
+    format_log_value(out, bm(outer));
+  });
+  out.push_back('}');
+}
+
+template<class T>
+void format_log_sequence(std::string& out, const T* first, std::size_t n) {
+  if constexpr(std::is_same_v<T, char>) {// up to the first NUL
+    out.push_back('"');
+    out.append(first, std::find(first, first + n, '\0'));
+    out.push_back('"');
+  }
+  else {
+    out.push_back('[');
+    for(std::size_t i=0; i<n; ++i) {
+      if(i) out += ", ";
+      format_log_value(out, first[i]);
+    }
+    out.push_back(']');
+  }
+}
+
+template<class T>
+void format_log_value(std::string& out, const T& t) {
+  if constexpr(std::is_same_v<T, bool>) {
+    out += t ? "true" : "false";
+  }
+  else if constexpr(std::is_arithmetic_v<T>) {
+    char buf[64];
+    auto res = std::to_chars(buf, buf + sizeof(buf), t);
+    out.append(buf, res.ptr);
+  }
+  else if constexpr(std::is_enum_v<T>) {
+    format_log_value(out, static_cast<std::underlying_type_t<T>>(t));
+  }
+  else if constexpr(std::is_array_v<T>) {
+    format_log_sequence(out, t, std::extent_v<T>);
+  }
+  else if constexpr(is_std_array<T>{}) {
+    format_log_sequence(out, t.data(), t.size());
+  }
+  else if constexpr(is_annotated<T>{}) {
+    format_log_object(out, t);
+  }
+  else {// raw bytes, in memory order
+    static constexpr char digits[] = "0123456789abcdef";
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, std::addressof(t), sizeof(T));
+    out += "0x";
+    for(unsigned char b : bytes) {
+      out.push_back(digits[b >> 4]);
+      out.push_back(digits[b & 15]);
+    }
+  }
+}
+
+template<class Outer>
+void format_log_thunk(std::string& out, const void* bytes) {
+  format_log_object(out, *static_cast<const Outer*>(bytes));
+}
+
+// Single-producer single-consumer ring of log records: a header of the
+// fingerprint and payload size, then the payload, padded to 8 bytes.
+// Records may wrap around the end of the buffer.
+class log_ring {
+ public:
+  struct header {
+    std::uint64_t fingerprint;
+    std::uint64_t size;
+  };
+
+  explicit log_ring(std::size_t capacity)
+    : mask_{capacity - 1}, buffer_{new unsigned char[capacity]} {}
+
+// false (and the record dropped) if the ring is full
+  bool push(std::uint64_t fp, const void* payload, std::size_t size) {
+    const std::size_t total = sizeof(header) + padded(size);
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if(head + total - cached_tail_ > mask_ + 1) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if(head + total - cached_tail_ > mask_ + 1) return false;
+    }
+    const header h{fp, size};
+    write(head, &h, sizeof(h));
+    write(head + sizeof(h), payload, size);
+    head_.store(head + total, std::memory_order_release);
+    return true;
+  }
+
+// calls `f(fingerprint, payload)` for each record, with `payload` copied to
+// storage aligned for any flat type; returns the number of records
+  template<class F>
+  std::size_t pop_all(std::vector<std::max_align_t>& scratch, F&& f) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    const std::size_t head = head_.load(std::memory_order_acquire);
+    std::size_t n = 0;
+    for(; tail != head; ++n) {
+      header h;
+      read(tail, &h, sizeof(h));
+      const std::size_t words =
+        (h.size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+      if(scratch.size() < words) scratch.resize(words);
+      read(tail + sizeof(h), scratch.data(), h.size);
+      f(h.fingerprint, std::string_view{
+        reinterpret_cast<const char*>(scratch.data()), h.size
+      });
+      tail += sizeof(h) + padded(h.size);
+      tail_.store(tail, std::memory_order_release);
+    }
+    return n;
+  }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+// set by the producer thread on exit; the consumer frees the ring once it
+// has drained it
+  void retire() { retired_.store(true, std::memory_order_release); }
+  bool retired() const { return retired_.load(std::memory_order_acquire); }
+
+ private:
+  const std::size_t mask_;
+  const std::unique_ptr<unsigned char[]> buffer_;
+  alignas(64) std::atomic<std::size_t> head_{0};
+  std::size_t cached_tail_ = 0;// producer's copy of `tail_`
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::atomic<bool> retired_{false};
+
+  static std::size_t padded(std::size_t size) {
+    return (size + 7) & ~std::size_t{7};
+  }
+
+  void write(std::size_t pos, const void* src, std::size_t n) {
+    const std::size_t off = pos & mask_;
+    const std::size_t first = std::min(n, mask_ + 1 - off);
+    std::memcpy(buffer_.get() + off, src, first);
+    std::memcpy(
+      buffer_.get(), static_cast<const unsigned char*>(src) + first, n - first
+    );
+  }
+
+  void read(std::size_t pos, void* dest, std::size_t n) const {
+    const std::size_t off = pos & mask_;
+    const std::size_t first = std::min(n, mask_ + 1 - off);
+    std::memcpy(dest, buffer_.get() + off, first);
+    std::memcpy(
+      static_cast<unsigned char*>(dest) + first, buffer_.get(), n - first
+    );
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// How to print a logged record from its bytes, keyed by `fingerprint`.
+struct log_format {
+  std::uint64_t fingerprint;
+  std::string_view name;
+  std::size_t size;
+  void (*format)(std::string& out, const void* bytes);
+};
+
+template<class Outer>
+constexpr log_format make_log_format() {
+  return {
+    fingerprint<Outer>, type_name<Outer>(), sizeof(Outer),
+    &detail::format_log_thunk<Outer>
+  };
+}
+
+// Formats of the logged types. `binary_log::log` adds each type to
+// `global()` on first use; offline tools add the types they expect.
+class log_formats {
+ public:
+  static log_formats& global() {
+    static log_formats ret;
+    return ret;
+  }
+
+  template<class Outer>
+  void add() { add(make_log_format<Outer>()); }
+
+  void add(const log_format& f) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    formats_.emplace(f.fingerprint, f);
+  }
+
+  std::optional<log_format> find(std::uint64_t fp) const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto it = formats_.find(fp);
+    if(it == formats_.end()) return std::nullopt;
+    return it->second;
+  }
+
+// appends `Type{member=value, ...}`, or a placeholder for unknown types
+  void format(
+    std::string& out, std::uint64_t fp, std::string_view payload
+  ) const {
+    auto f = find(fp);
+    if(f && f->size == payload.size()) {
+      f->format(out, payload.data());
+    }
+    else {
+      out += "<unknown record ";
+      detail::format_log_value(out, fp);
+      out.push_back('>');
+    }
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::unordered_map<std::uint64_t, log_format> formats_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Logging of flat annotated records with formatting deferred to a consumer:
+// `log` copies the record's bytes and fingerprint into a ring owned by the
+// calling thread, without locks or formatting; `poll` hands out the raw
+// records (e.g. to write to a file for an offline tool) and `format` turns
+// them into text by member name:
+// ```
+// ecrypa::binary_log logger;
+// logger.log(Fill{42, 100.25, 7});             // hot path
+// std::string text;
+// logger.format(text);                         // "Fill{id=42, px=100.25, ...}"
+// ```
+// A full ring drops the record (counted by `dropped`) rather than block.
+// Records of one thread stay in order; add a timestamp member to order
+// records across threads. Call `poll` and `format` from one thread at a
+// time.
+class binary_log {
+ public:
+// `ring_bytes` per logging thread, rounded up to a power of two
+  explicit binary_log(std::size_t ring_bytes = std::size_t{1} << 20)
+    : ring_bytes_{round_up(std::max<std::size_t>(ring_bytes, 64))} {}
+
+  binary_log(const binary_log&) = delete;
+  binary_log& operator=(const binary_log&) = delete;
+
+  template<class Outer>
+  bool log(const Outer& record) {
+    static_assert(is_flat_v<Outer>, "binary_log: records must be flat");
+    static const bool added = (log_formats::global().add<Outer>(), true);
+    (void)added;
+    if(local().push(fingerprint<Outer>, &record, sizeof(Outer))) return true;
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+// calls `f(fingerprint, payload)` for each record logged since the last
+// call, thread by thread; returns the number of records. Rings of exited
+// threads are freed once drained.
+  template<class F>
+  std::size_t poll(F&& f) {
+    std::vector<detail::log_ring*> rings;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      for(auto& r : rings_) rings.push_back(r.get());
+    }
+    std::size_t n = 0;
+    std::vector<detail::log_ring*> drained;// retired before draining
+    for(detail::log_ring* r : rings) {
+      const bool retired = r->retired();
+      n += r->pop_all(scratch_, f);
+      if(retired) drained.push_back(r);
+    }
+    if(!drained.empty()) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      rings_.erase(std::remove_if(
+        rings_.begin(), rings_.end(), [&] (const auto& r) {
+          return std::find(drained.begin(), drained.end(), r.get())
+            != drained.end();
+        }
+      ), rings_.end());
+    }
+    return n;
+  }
+
+// appends the pending records as lines of text
+  std::size_t format(
+    std::string& out, const log_formats& formats = log_formats::global()
+  ) {
+    return poll([&] (std::uint64_t fp, std::string_view payload) {
+      formats.format(out, fp, payload);
+      out.push_back('\n');
+    });
+  }
+
+  std::size_t dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  const std::size_t ring_bytes_;
+  const std::uint64_t id_ = next_id();
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<detail::log_ring>> rings_;
+  std::vector<std::max_align_t> scratch_;
+  std::atomic<std::size_t> dropped_{0};
+
+  static std::size_t round_up(std::size_t n) {
+    std::size_t ret = 1;
+    while(ret < n) ret *= 2;
+    return ret;
+  }
+
+  static std::uint64_t next_id() {
+    static std::atomic<std::uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+  }
+
+// Rings of the calling thread by logger id; retires them when the thread
+// exits. Ids are never reused, so entries of destroyed loggers never match
+// and are dropped when the next ring is added.
+  struct thread_rings {
+    struct entry {
+      std::uint64_t id;
+      detail::log_ring* ring;
+      std::weak_ptr<detail::log_ring> owner;
+    };
+    std::vector<entry> entries;
+
+    ~thread_rings() {
+      for(entry& e : entries) {
+        if(auto ring = e.owner.lock()) ring->retire();
+      }
+    }
+  };
+
+// the calling thread's ring, created on first use
+  detail::log_ring& local() {
+    thread_local thread_rings own;
+    for(auto& e : own.entries) {
+      if(e.id == id_) return *e.ring;
+    }
+    auto& entries = own.entries;
+    entries.erase(std::remove_if(
+      entries.begin(), entries.end(), [] (const auto& e) {
+        return e.owner.expired();
+      }
+    ), entries.end());
+    std::lock_guard<std::mutex> lock{mutex_};
+    rings_.push_back(std::make_shared<detail::log_ring>(ring_bytes_));
+    entries.push_back({id_, rings_.back().get(), rings_.back()});
+    return *rings_.back();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
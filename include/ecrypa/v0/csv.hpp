@@ -0,0 +1,392 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <charconv>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// `csv_field<T>::write(out, t, delimiter)` appends the text of `t`;
+// `csv_field<T>::read(field, t)` parses a whole unquoted field into `t` and
+// returns false on malformed input. Specialize for more types.
+template<class T, class ExpressionSfinae = void>
+struct csv_field;
+
+template<>
+struct csv_field<bool> {
+  static void write(std::string& out, bool b, char) {
+    out.push_back(b ? '1' : '0');
+  }
+  static bool read(std::string_view field, bool& b) {
+    if(field == "1" || field == "true") b = true;
+    else if(field == "0" || field == "false") b = false;
+    else return false;
+    return true;
+  }
+};
+
+// integral and floating-point types via `std::to_chars`/`std::from_chars`
+template<class T>
+struct csv_field<
+  T,
+  std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>
+> {
+  static void write(std::string& out, T t, char) {
+    char buf[64];
+    auto res = std::to_chars(buf, buf + sizeof(buf), t);
+    out.append(buf, res.ptr);
+  }
+  static bool read(std::string_view field, T& t) {
+    const char* last = field.data() + field.size();
+    auto res = std::from_chars(field.data(), last, t);
+    return res.ec == std::errc{} && res.ptr == last;
+  }
+};
+
+// enums as their underlying value
+template<class T>
+struct csv_field<T, std::enable_if_t<std::is_enum_v<T>>> {
+  using U = std::underlying_type_t<T>;
+  static void write(std::string& out, T t, char delimiter) {
+    csv_field<U>::write(out, static_cast<U>(t), delimiter);
+  }
+  static bool read(std::string_view field, T& t) {
+    U u;
+    if(!csv_field<U>::read(field, u)) return false;
+    t = static_cast<T>(u);
+    return true;
+  }
+};
+
+// quoted when containing the delimiter, quotes or line breaks
+template<class Traits, class Allocator>
+struct csv_field<std::basic_string<char, Traits, Allocator>> {
+  using T = std::basic_string<char, Traits, Allocator>;
+
+  static void write(std::string& out, const T& t, char delimiter) {
+    const char specials[] = {delimiter, '"', '\n', '\r', '\0'};
+    if(t.find_first_of(specials, 0, 4) == T::npos) {
+      out.append(t.data(), t.size());
+      return;
+    }
+    out.push_back('"');
+    for(char c : t) {
+      if(c == '"') out.push_back('"');
+      out.push_back(c);
+    }
+    out.push_back('"');
+  }
+  static bool read(std::string_view field, T& t) {
+    t.assign(field.data(), field.size());
+    return true;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class csv_error : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Header row: the names of the members of `Outer`.
+template<class Outer>
+void append_csv_header(std::string& out, char delimiter = ',') {
+  bool first = true;
+  each_member<Outer>([&] (auto m) {
+    if(!first) out.push_back(delimiter);
+    first = false;
+    out.append(m.inner_name());
+  });
+  out.push_back('\n');
+}
+
+template<class Outer>
+void append_csv_row(
+  std::string& out, const Outer& outer, char delimiter = ','
+) {
+  bool first = true;
+  each_member<Outer>([&] (auto m) {
+    using Inner = std::decay_t<typename decltype(m)::inner_type>;
+    if(!first) out.push_back(delimiter);
+    first = false;
+    csv_field<Inner>::write(out, m(outer), delimiter);
+  });
+  out.push_back('\n');
+}
+
+// Writes a header and one row per record, flushing to `os` in large chunks.
+template<class Range>
+void write_csv(std::ostream& os, const Range& records, char delimiter = ',') {
+  using Outer = std::decay_t<decltype(*std::begin(records))>;
+  std::string buf;
+  append_csv_header<Outer>(buf, delimiter);
+  for(const Outer& outer : records) {
+    append_csv_row(buf, outer, delimiter);
+    if(buf.size() >= (1 << 16)) {
+      os.write(buf.data(), std::streamsize(buf.size()));
+      buf.clear();
+    }
+  }
+  os.write(buf.data(), std::streamsize(buf.size()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Finds field breaks (delimiter, '\n', '\r') a 64-byte window at a time: the
+// window is classified into a bitmask (with SSE2 where available), and breaks
+// are then popped off the mask.
+class csv_scanner {
+ public:
+  csv_scanner(const char* end, char delimiter)
+    : end_{end}, window_{end}, delimiter_{delimiter} {}
+
+  const char* next_break(const char* p) {
+    for(;;) {
+      if(std::size_t(p - window_) < window_size_) {
+        auto mask = mask_ & (~std::uint64_t{0} << (p - window_));
+        if(mask) return window_ + __builtin_ctzll(mask);
+        p = window_ + window_size_;
+      }
+      if(end_ - p < 64) {
+        while(p != end_ && !is_break(*p)) ++p;
+        return p;
+      }
+      window_ = p;
+      window_size_ = 64;
+      mask_ = classify(p);
+    }
+  }
+
+ private:
+  const char* end_;
+  const char* window_;
+  std::size_t window_size_ = 0;
+  std::uint64_t mask_ = 0;
+  char delimiter_;
+
+  bool is_break(char c) const {
+    return (c == delimiter_) | (c == '\n') | (c == '\r');
+  }
+
+  std::uint64_t classify(const char* p) const {
+#if defined(__SSE2__)
+    const __m128i d = _mm_set1_epi8(delimiter_);
+    const __m128i n = _mm_set1_epi8('\n');
+    const __m128i r = _mm_set1_epi8('\r');
+    std::uint64_t mask = 0;
+    for(std::size_t j=0; j<64; j+=16) {
+      auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + j));
+      auto m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, d), _mm_cmpeq_epi8(v, n)),
+        _mm_cmpeq_epi8(v, r)
+      );
+      mask |= std::uint64_t(unsigned(_mm_movemask_epi8(m))) << j;
+    }
+#else
+    unsigned char breaks[64];
+    for(std::size_t j=0; j<64; ++j) breaks[j] = is_break(p[j]);
+    std::uint64_t mask = 0;
+    for(std::size_t j=0; j<64; ++j) mask |= std::uint64_t{breaks[j]} << j;
+#endif
+    return mask;
+  }
+};
+
+template<class Outer>
+using csv_reader_fn = bool (*)(std::string_view, Outer&);
+
+template<class Outer, class Member>
+bool read_csv_member(std::string_view field, Outer& outer) {
+  using Target = decltype(Member{}(outer));
+  using Inner = std::remove_reference_t<Target>;
+  if constexpr(std::is_lvalue_reference_v<Target> && !std::is_const_v<Inner>) {
+    return csv_field<std::decay_t<Inner>>::read(field, Member{}(outer));
+  }
+  else {
+    return true;// not assignable
+  }
+}
+
+// one parse function per member, indexed like `members<Outer>`
+template<class Outer>
+const auto& csv_member_readers() {
+  static const auto ret = apply_members<Outer>([] (auto... ms) {
+    return std::array<csv_reader_fn<Outer>, sizeof...(ms)>{
+      &read_csv_member<Outer, decltype(ms)>...
+    };
+  });
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Reads records from CSV text with a header row. Header columns are matched
+// to member names once; unknown columns are skipped and members without a
+// column are left alone. Throws `csv_error` on malformed input.
+// ```
+// ecrypa::csv_reader<Order> reader{text};
+// for(Order order; reader.next(order); ) { ... }
+// ```
+template<class Outer>
+class csv_reader {
+ public:
+  explicit csv_reader(std::string_view input, char delimiter = ',')
+    : p_{input.data()},
+      end_{input.data() + input.size()},
+      delimiter_{delimiter},
+      scanner_{end_, delimiter}
+  {
+    const auto& readers = detail::csv_member_readers<Outer>();
+    std::string_view field;
+    bool more = p_ != end_;
+    while(more) {
+      more = next_field(field);
+      auto& reader = columns_.emplace_back(nullptr);
+      std::size_t i = 0;
+      each_member<Outer>([&] (auto m) {
+        if(field == m.inner_name()) reader = readers[i];
+        ++i;
+      });
+    }
+  }
+
+// reads the next row into `outer`; false at the end of the input
+  bool next(Outer& outer) {
+    while(p_ != end_ && (*p_ == '\n' || *p_ == '\r')) {
+      line_ += (*p_ == '\n');
+      ++p_;
+    }
+    if(p_ == end_) return false;
+
+    // the last field consumes the row's newline: report the row's first line
+    const std::size_t line = line_;
+    std::string_view field;
+    for(std::size_t col=0; col<columns_.size(); ++col) {
+      bool more = next_field(field);
+      if(more != (col + 1 < columns_.size())) {
+        error(line, more ? "too many fields" : "too few fields");
+      }
+      if(columns_[col] && !columns_[col](field, outer)) {
+        error(line, "cannot parse field " + std::to_string(col + 1));
+      }
+    }
+    return true;
+  }
+
+ private:
+  const char* p_;
+  const char* end_;
+  char delimiter_;
+  detail::csv_scanner scanner_;
+  std::vector<detail::csv_reader_fn<Outer>> columns_;
+  std::string unquoted_;
+  std::size_t line_ = 1;
+
+  [[noreturn]] void error(const std::string& what) const {
+    error(line_, what);
+  }
+
+  [[noreturn]] static void error(std::size_t line, const std::string& what) {
+    throw csv_error("csv: line " + std::to_string(line) + ": " + what);
+  }
+
+// sets `field` and consumes its terminator; true if another field follows
+// on the same row
+  bool next_field(std::string_view& field) {
+    const char* last;
+    if(p_ != end_ && *p_ == '"') {
+      unquoted_.clear();
+      for(const char* q = p_ + 1;;) {
+        auto quote = static_cast<const char*>(
+          std::memchr(q, '"', std::size_t(end_ - q))
+        );
+        if(!quote) error("unterminated quote");
+        unquoted_.append(q, quote);
+        if(quote + 1 != end_ && quote[1] == '"') {
+          unquoted_.push_back('"');
+          q = quote + 2;
+          continue;
+        }
+        last = quote + 1;
+        break;
+      }
+      for(const char* q = p_; q != last; ++q) line_ += (*q == '\n');
+      field = unquoted_;
+      if(
+        last != end_
+        && *last != delimiter_ && *last != '\n' && *last != '\r'
+      ) {
+        error("unexpected character after quoted field");
+      }
+    }
+    else {
+      last = scanner_.next_break(p_);
+      field = std::string_view(p_, std::size_t(last - p_));
+    }
+
+    if(last != end_ && *last == delimiter_) {
+      p_ = last + 1;
+      return true;
+    }
+    p_ = last;
+    if(p_ != end_ && *p_ == '\r') ++p_;
+    if(p_ != end_ && *p_ == '\n') {
+      ++p_;
+      ++line_;
+    }
+    return false;
+  }
+};
+
+// All records of `input`, see `csv_reader`.
+template<class Outer>
+std::vector<Outer> read_csv(std::string_view input, char delimiter = ',') {
+  std::vector<Outer> ret;
+  csv_reader<Outer> reader{input, delimiter};
+  for(Outer outer{}; reader.next(outer); outer = Outer{}) {
+    ret.push_back(std::move(outer));
+  }
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
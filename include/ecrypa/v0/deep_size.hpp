@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstddef>
+
+#include <array>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/traits.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// `heap_size_of<T>::get(t)` returns the heap bytes owned by `t`, excluding
+// `sizeof(T)` itself. Specialize it for types not covered here. Node-based
+// containers are charged a per-node estimate; allocator bookkeeping is not
+// counted.
+template<class T, class ExpressionSfinae = void>
+struct heap_size_of {
+  static_assert(
+    std::is_trivially_copyable_v<T>,
+    "heap_size_of: specialize for types that might own heap memory"
+  );
+  static constexpr std::size_t get(const T&) { return 0; }
+};
+
+template<class T>
+std::size_t heap_size(const T& t) { return heap_size_of<T>::get(t); }
+
+template<class T>
+std::size_t deep_size(const T& t) { return sizeof(T) + heap_size(t); }
+
+////////////////////////////////////////////////////////////////////////////////
+
+// annotated types: sum over bases and nonreference members
+template<class Outer>
+struct heap_size_of<Outer, std::enable_if_t<is_annotated<Outer>{}>> {
+  static std::size_t get(const Outer& outer) {
+    return apply_items<Outer>([&] (auto... bms) {
+      return (std::size_t{0} + ... + item_heap_size(bms, outer));
+    });
+  }
+
+ private:
+  template<class Item>
+  static std::size_t item_heap_size(Item bm, const Outer& outer) {
+    using Inner = typename Item::inner_type;
+    if constexpr(std::is_reference_v<Inner>) {
+      return 0;// not owned
+    }
+    else {
+      return heap_size_of<Inner>::get(bm(outer));
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class C, class Traits, class Alloc>
+struct heap_size_of<std::basic_string<C, Traits, Alloc>> {
+  static std::size_t get(const std::basic_string<C, Traits, Alloc>& s) {
+    const void* first = &s;
+    const void* last = &s + 1;
+    const void* data = s.data();
+    bool is_sso = !(data < first) && data < last;
+    return is_sso ? 0 : (s.capacity() + 1) * sizeof(C);
+  }
+};
+
+template<class T, class Alloc>
+struct heap_size_of<std::vector<T, Alloc>> {
+  static std::size_t get(const std::vector<T, Alloc>& v) {
+    std::size_t ret = v.capacity() * sizeof(T);
+    for(const T& t : v) ret += heap_size(t);
+    return ret;
+  }
+};
+
+template<class Alloc>
+struct heap_size_of<std::vector<bool, Alloc>> {
+  static std::size_t get(const std::vector<bool, Alloc>& v) {
+    return (v.capacity() + 7) / 8;
+  }
+};
+
+template<class T, class Alloc>
+struct heap_size_of<std::deque<T, Alloc>> {
+  static std::size_t get(const std::deque<T, Alloc>& d) {
+    std::size_t ret = d.size() * sizeof(T);
+    for(const T& t : d) ret += heap_size(t);
+    return ret;
+  }
+};
+
+template<class T, std::size_t N>
+struct heap_size_of<std::array<T, N>> {
+  static std::size_t get(const std::array<T, N>& a) {
+    std::size_t ret = 0;
+    for(const T& t : a) ret += heap_size(t);
+    return ret;
+  }
+};
+
+template<class T, std::size_t N>
+struct heap_size_of<T[N]> {
+  static std::size_t get(const T (&a)[N]) {
+    std::size_t ret = 0;
+    for(const T& t : a) ret += heap_size(t);
+    return ret;
+  }
+};
+
+template<class First, class Second>
+struct heap_size_of<std::pair<First, Second>> {
+  static std::size_t get(const std::pair<First, Second>& p) {
+    return heap_size(p.first) + heap_size(p.second);
+  }
+};
+
+template<class T>
+struct heap_size_of<std::optional<T>> {
+  static std::size_t get(const std::optional<T>& o) {
+    return o ? heap_size(*o) : 0;
+  }
+};
+
+template<class T, class Deleter>
+struct heap_size_of<std::unique_ptr<T, Deleter>> {
+  static std::size_t get(const std::unique_ptr<T, Deleter>& p) {
+    return p ? deep_size(*p) : 0;
+  }
+};
+
+// The length of the array is not stored, so the owner of a `unique_ptr<T[]>`
+// must count it in its own specialization.
+template<class T, class Deleter>
+struct heap_size_of<std::unique_ptr<T[], Deleter>> {
+  static_assert(
+    !std::is_same_v<T, T>,
+    "heap_size_of: the length of a unique_ptr<T[]> is unknown; specialize "
+    "for the type that owns it"
+  );
+  static std::size_t get(const std::unique_ptr<T[], Deleter>&) { return 0; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// red-black tree node: color, parent, left, right
+constexpr std::size_t tree_node_overhead = 4 * sizeof(void*);
+
+// singly linked node with cached hash
+constexpr std::size_t hash_node_overhead = 2 * sizeof(void*);
+
+template<class Container>
+std::size_t tree_heap_size(const Container& c) {
+  using V = typename Container::value_type;
+  std::size_t ret = c.size() * (tree_node_overhead + sizeof(V));
+  for(const V& v : c) ret += ::ecrypa::heap_size(v);
+  return ret;
+}
+
+template<class Container>
+std::size_t hash_heap_size(const Container& c) {
+  using V = typename Container::value_type;
+  std::size_t ret = c.bucket_count() * sizeof(void*)
+    + c.size() * (hash_node_overhead + sizeof(V));
+  for(const V& v : c) ret += ::ecrypa::heap_size(v);
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class Key, class T, class Compare, class Alloc>
+struct heap_size_of<std::map<Key, T, Compare, Alloc>> {
+  static std::size_t get(const std::map<Key, T, Compare, Alloc>& m) {
+    return detail::tree_heap_size(m);
+  }
+};
+
+template<class Key, class T, class Compare, class Alloc>
+struct heap_size_of<std::multimap<Key, T, Compare, Alloc>> {
+  static std::size_t get(const std::multimap<Key, T, Compare, Alloc>& m) {
+    return detail::tree_heap_size(m);
+  }
+};
+
+template<class Key, class Compare, class Alloc>
+struct heap_size_of<std::set<Key, Compare, Alloc>> {
+  static std::size_t get(const std::set<Key, Compare, Alloc>& s) {
+    return detail::tree_heap_size(s);
+  }
+};
+
+template<class Key, class T, class Hash, class Eq, class Alloc>
+struct heap_size_of<std::unordered_map<Key, T, Hash, Eq, Alloc>> {
+  using Map = std::unordered_map<Key, T, Hash, Eq, Alloc>;
+  static std::size_t get(const Map& m) {
+    return detail::hash_heap_size(m);
+  }
+};
+
+template<class Key, class Hash, class Eq, class Alloc>
+struct heap_size_of<std::unordered_set<Key, Hash, Eq, Alloc>> {
+  static std::size_t get(const std::unordered_set<Key, Hash, Eq, Alloc>& s) {
+    return detail::hash_heap_size(s);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct item_size {
+  const char* name;// `inner_name()`
+  std::size_t size;// `sizeof` plus owned heap bytes
+};
+
+// per-item breakdown of `deep_size(outer)`; padding of `Outer` is not listed,
+// and reference members count 0, as in `heap_size`
+template<class Outer>
+auto deep_size_breakdown(const Outer& outer) {
+  static_assert(is_annotated<Outer>{});
+  return apply_items<Outer>([&] (auto... bms) {
+    const auto entry = [&] (auto bm) {
+      using Inner = typename decltype(bm)::inner_type;
+      if constexpr(std::is_reference_v<Inner>) {
+        return item_size{bm.inner_name(), 0};// not owned
+      }
+      else {
+        return item_size{bm.inner_name(), deep_size(bm(outer))};
+      }
+    };
+    return std::array<item_size, sizeof...(bms)>{entry(bms)...};
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
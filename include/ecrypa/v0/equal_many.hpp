@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/serialize.hpp>
+#include <ecrypa/v0/traits.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// true if the `n` bytes at `p` and `q` are equal, compared 16 at a time
+// without branching on partial results
+inline bool bytes_equal(
+  const unsigned char* p, const unsigned char* q, std::size_t n
+) {
+  std::size_t i = 0;
+  std::uint64_t diff = 0;
+#if defined(__SSE2__)
+  __m128i eq = _mm_set1_epi8(-1);
+  for(; i + 16 <= n; i += 16) {
+    auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q + i));
+    eq = _mm_and_si128(eq, _mm_cmpeq_epi8(x, y));
+  }
+  diff = unsigned(_mm_movemask_epi8(eq)) ^ 0xffffu;
+#endif
+  for(; i + 8 <= n; i += 8) {
+    std::uint64_t x, y;
+    std::memcpy(&x, p + i, 8);
+    std::memcpy(&y, q + i, 8);
+    diff |= x ^ y;
+  }
+  for(; i < n; ++i) diff |= p[i] ^ q[i];
+  return diff == 0;
+}
+
+template<class T, class ExpressionSfinae = void>
+struct is_bytewise_comparable;
+
+template<class Outer, std::size_t... is>
+constexpr bool items_bytewise_comparable(std::index_sequence<is...>) {
+  return (true && ... && (
+    !std::is_reference_v<typename item<is, Outer>::inner_type>
+    && is_bytewise_comparable<typename item<is, Outer>::inner_type>{}
+  )) && (0 + ... + sizeof(typename item<is, Outer>::inner_type))
+    == sizeof(Outer);
+}
+
+// Types whose `==` is equality of their bytes: integers, enums, pointers,
+// and arrays of them, and annotated types without padding whose items are
+// such types and cover all of their bytes. Not floating-point types, since
+// `0.0 == -0.0` and `NaN != NaN`.
+template<class T, class ExpressionSfinae>
+struct is_bytewise_comparable : std::bool_constant<
+  (std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>)
+  && std::has_unique_object_representations_v<T>
+> {};
+
+template<class T, std::size_t N>
+struct is_bytewise_comparable<T[N]> : is_bytewise_comparable<T> {};
+
+template<class T, std::size_t N>
+struct is_bytewise_comparable<std::array<T, N>> : std::bool_constant<
+  is_bytewise_comparable<T>{} && sizeof(std::array<T, N>) == N * sizeof(T)
+> {};
+
+template<class T>
+struct is_bytewise_comparable<T, std::enable_if_t<is_annotated<T>{}>>
+  : std::bool_constant<
+    std::has_unique_object_representations_v<T>
+    && items_bytewise_comparable<T>(items<T>::ind_seq)
+  > {};
+
+struct byte_run {
+  std::size_t offset;
+  std::size_t size;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Compares records of `Outer` like the item-wise `operator==` of
+// serialize.hpp, but compares items whose `==` is byte equality as runs of
+// adjacent bytes, 16 bytes at a time with SSE2; other items use `==`.
+// Item offsets are taken from `sample` once.
+template<class Outer>
+class record_comparer {
+  static constexpr std::size_t count = items<Outer>::count;
+
+  template<class Item>
+  static constexpr bool bytewise = !std::is_reference_v<
+    typename Item::inner_type
+  > && detail::is_bytewise_comparable<typename Item::inner_type>{};
+
+ public:
+  explicit record_comparer(const Outer& sample) {
+    const auto base = reinterpret_cast<const unsigned char*>(&sample);
+    std::size_t i = 0;
+    each_item<Outer>([&] (auto bm) {
+      using Item = decltype(bm);
+      const auto p = reinterpret_cast<const unsigned char*>(
+        std::addressof(bm(sample))
+      );
+      offsets_[i++] = std::size_t(p - base);
+      if constexpr(bytewise<Item>) {
+        const std::size_t offset = std::size_t(p - base);
+        constexpr std::size_t size = sizeof(typename Item::inner_type);
+        if(runs_size_ && offset == end_of(runs_[runs_size_ - 1])) {
+          runs_[runs_size_ - 1].size += size;
+        }
+        else {
+          runs_[runs_size_++] = {offset, size};
+        }
+      }
+    });
+  }
+
+  bool equal(const Outer& a, const Outer& b) const {
+    const auto p = reinterpret_cast<const unsigned char*>(&a);
+    const auto q = reinterpret_cast<const unsigned char*>(&b);
+    if constexpr(detail::is_bytewise_comparable<Outer>{}) {
+      return detail::bytes_equal(p, q, sizeof(Outer));
+    }
+    else {
+      for(std::size_t r=0; r<runs_size_; ++r) {
+        const detail::byte_run& run = runs_[r];
+        if(!detail::bytes_equal(p + run.offset, q + run.offset, run.size)) {
+          return false;
+        }
+      }
+      return apply_items<Outer>([&] (auto... bms) {
+        return (true && ... && item_equal(bms, a, b));
+      });
+    }
+  }
+
+// `item(a) == item(b)`
+  template<class Item>
+  bool item_equal_at(Item item, const Outer& a, const Outer& b) const {
+    if constexpr(bytewise<Item>) {
+      const std::size_t offset = offsets_[Item::idx];
+      return detail::bytes_equal(
+        reinterpret_cast<const unsigned char*>(&a) + offset,
+        reinterpret_cast<const unsigned char*>(&b) + offset,
+        sizeof(typename Item::inner_type)
+      );
+    }
+    else {
+      return item(a) == item(b);
+    }
+  }
+
+ private:
+  std::array<detail::byte_run, count> runs_{};
+  std::size_t runs_size_ = 0;
+  std::array<std::size_t, count> offsets_{};
+
+  static std::size_t end_of(const detail::byte_run& run) {
+    return run.offset + run.size;
+  }
+
+// items outside the runs
+  template<class Item>
+  static bool item_equal(Item item, const Outer& a, const Outer& b) {
+    if constexpr(bytewise<Item>) return true;
+    else return item(a) == item(b);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Bit `j % 64` of word `j / 64` is set if `a[j] == b[j]`, for `j < n`,
+// with `==` as in serialize.hpp:
+// ```
+// auto same = ecrypa::equal_many(yesterday.data(), today.data(), n);
+// bool changed = !(same[j / 64] >> (j % 64) & 1);
+// ```
+template<class Outer>
+std::vector<std::uint64_t> equal_many(
+  const Outer* a, const Outer* b, std::size_t n
+) {
+  std::vector<std::uint64_t> ret((n + 63) / 64, 0);
+  if(n == 0) return ret;
+  const record_comparer<Outer> comparer{a[0]};
+  for(std::size_t w=0; w<ret.size(); ++w) {
+    const std::size_t first = 64 * w;
+    const std::size_t last = std::min(n, first + 64);
+    std::uint64_t word = 0;
+    for(std::size_t j=first; j<last; ++j) {
+      word |= std::uint64_t{comparer.equal(a[j], b[j])} << (j - first);
+    }
+    ret[w] = word;
+  }
+  return ret;
+}
+
+// Bit `i` is set if item `i` of `Outer` differs between `a[j]` and `b[j]`
+// for some `j < n`; stops comparing an item once it differs.
+template<class Outer>
+std::bitset<items<Outer>::count> differing_items(
+  const Outer* a, const Outer* b, std::size_t n
+) {
+  std::bitset<items<Outer>::count> ret;
+  if(n == 0) return ret;
+  const record_comparer<Outer> comparer{a[0]};
+  for(std::size_t j=0; j<n && !ret.all(); ++j) {
+    each_item<Outer>([&] (auto bm) {
+      constexpr std::size_t i = decltype(bm)::idx;
+      if(!ret[i] && !comparer.item_equal_at(bm, a[j], b[j])) ret.set(i);
+    });
+  }
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/layout.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// One bit per record, as produced by `scan`.
+class selection {
+ public:
+  selection() = default;
+  explicit selection(std::size_t size)
+    : size_{size}, words_((size + 63) / 64) {}
+
+  std::size_t size() const { return size_; }
+
+  bool operator[](std::size_t i) const {
+    return (words_[i / 64] >> (i % 64)) & 1;
+  }
+
+  std::size_t count() const {
+    std::size_t n = 0;
+    for(auto w : words_) n += std::size_t(__builtin_popcountll(w));
+    return n;
+  }
+
+  std::uint64_t* words() { return words_.data(); }
+  const std::uint64_t* words() const { return words_.data(); }
+  std::size_t word_count() const { return words_.size(); }
+
+// calls `f(i)` for each selected index, in increasing order
+  template<class F>
+  void for_each(F&& f) const {
+    for(std::size_t w=0; w<words_.size(); ++w) {
+      for(auto bits = words_[w]; bits; bits &= bits - 1) {
+        f(w * 64 + std::size_t(__builtin_ctzll(bits)));
+      }
+    }
+  }
+
+  selection& operator&=(const selection& rhs) {
+    for(std::size_t w=0; w<words_.size(); ++w) words_[w] &= rhs.words_[w];
+    return *this;
+  }
+  selection& operator|=(const selection& rhs) {
+    for(std::size_t w=0; w<words_.size(); ++w) words_[w] |= rhs.words_[w];
+    return *this;
+  }
+
+ private:
+  std::size_t size_ = 0;
+  std::vector<std::uint64_t> words_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Predicates evaluate blocks of up to 64 records at once:
+// `p.block(first, n)` has bit `j` set iff record `first[j]` matches.
+template<class Derived>
+struct predicate {
+  const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+template<class T>
+constexpr bool is_predicate_v =
+  std::is_base_of_v<predicate<std::decay_t<T>>, std::decay_t<T>>;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// comparisons on a member value
+template<class T> struct equal_to_value {
+  T value;
+  bool operator()(const T& t) const { return t == value; }
+};
+template<class T> struct not_equal_to_value {
+  T value;
+  bool operator()(const T& t) const { return t != value; }
+};
+template<class T> struct less_than_value {
+  T value;
+  bool operator()(const T& t) const { return t < value; }
+};
+template<class T> struct less_equal_value {
+  T value;
+  bool operator()(const T& t) const { return t <= value; }
+};
+template<class T> struct greater_than_value {
+  T value;
+  bool operator()(const T& t) const { return value < t; }
+};
+template<class T> struct greater_equal_value {
+  T value;
+  bool operator()(const T& t) const { return value <= t; }
+};
+
+// `lo <= t && t <= hi`, without branches for arithmetic `T`
+template<class T> struct between_values {
+  T lo, hi;
+  bool operator()(const T& t) const { return (lo <= t) & (t <= hi); }
+};
+
+// membership in a sorted set: linear and branch-free while small
+template<class T> struct in_values {
+  std::vector<T> values;
+
+  explicit in_values(std::vector<T> vs) : values(std::move(vs)) {
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+  }
+
+  bool operator()(const T& t) const {
+    if(values.size() > 8) {
+      return std::binary_search(values.begin(), values.end(), t);
+    }
+    bool found = false;
+    for(const T& v : values) found |= (t == v);
+    return found;
+  }
+
+// batch form used by `member_predicate`: one vectorizable pass per value
+  void operator()(const T* ts, unsigned char* matches, std::size_t n) const {
+    if(values.size() > 8) {
+      for(std::size_t j=0; j<n; ++j) matches[j] = (*this)(ts[j]);
+      return;
+    }
+    std::fill_n(matches, n, 0);
+    for(const T& v : values) {
+      for(std::size_t j=0; j<n; ++j) matches[j] |= (ts[j] == v);
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Leaf predicate: `Test` applied to the member selected by `Item`. Strided
+// members are gathered a block at a time (see `gather`), and tests may provide
+// a batch form `test(values, matches, n)` for them; other members are tested
+// in place, record by record.
+template<class Item, class Test>
+class member_predicate : public predicate<member_predicate<Item, Test>> {
+ public:
+  using outer_type = typename Item::outer_type;
+
+  explicit member_predicate(Test test) : test_{std::move(test)} {}
+
+  std::uint64_t block(const outer_type* first, std::size_t n) const {
+    // full blocks get a constant trip count, which is what vectorizes
+    return n == 64 ? block_n(first, 64) : block_n(first, n);
+  }
+
+ private:
+  using Inner = std::decay_t<typename Item::inner_type>;
+
+  Test test_;
+
+  std::uint64_t block_n(const outer_type* first, std::size_t n) const {
+    unsigned char matches[64];
+    if constexpr(is_strided_v<Item>) {
+      Inner values[64];
+      gather(Item{}, first, n, values);
+      if constexpr(std::is_invocable_v<
+        const Test&, const Inner*, unsigned char*, std::size_t
+      >) {
+        test_(values, matches, n);
+      }
+      else {
+        for(std::size_t j=0; j<n; ++j) matches[j] = test_(values[j]);
+      }
+    }
+    else {
+      for(std::size_t j=0; j<n; ++j) matches[j] = test_(Item{}(first[j]));
+    }
+    std::uint64_t bits = 0;
+    for(std::size_t j=0; j<n; ++j) bits |= std::uint64_t{matches[j]} << j;
+    return bits;
+  }
+};
+
+// `&` skips its right-hand side for blocks where the left selects nothing,
+// `|` for blocks where the left selects everything
+template<class L, class R>
+class and_predicate : public predicate<and_predicate<L, R>> {
+ public:
+  using outer_type = typename L::outer_type;
+
+  and_predicate(L l, R r) : l_{std::move(l)}, r_{std::move(r)} {}
+
+  std::uint64_t block(const outer_type* first, std::size_t n) const {
+    auto bits = l_.block(first, n);
+    return bits ? bits & r_.block(first, n) : 0;
+  }
+
+ private:
+  L l_;
+  R r_;
+};
+
+template<class L, class R>
+class or_predicate : public predicate<or_predicate<L, R>> {
+ public:
+  using outer_type = typename L::outer_type;
+
+  or_predicate(L l, R r) : l_{std::move(l)}, r_{std::move(r)} {}
+
+  std::uint64_t block(const outer_type* first, std::size_t n) const {
+    auto bits = l_.block(first, n);
+    auto all = n == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+    return bits == all ? bits : bits | r_.block(first, n);
+  }
+
+ private:
+  L l_;
+  R r_;
+};
+
+template<class P>
+class not_predicate : public predicate<not_predicate<P>> {
+ public:
+  using outer_type = typename P::outer_type;
+
+  explicit not_predicate(P p) : p_{std::move(p)} {}
+
+  std::uint64_t block(const outer_type* first, std::size_t n) const {
+    auto all = n == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+    return ~p_.block(first, n) & all;
+  }
+
+ private:
+  P p_;
+};
+
+template<class L, class R, class = std::enable_if_t<is_predicate_v<L>>>
+auto operator&(const predicate<L>& l, const predicate<R>& r) {
+  static_assert(
+    std::is_same_v<typename L::outer_type, typename R::outer_type>,
+    "predicate: combined predicates must refer to the same outer type"
+  );
+  return and_predicate<L, R>{l.self(), r.self()};
+}
+
+template<class L, class R, class = std::enable_if_t<is_predicate_v<L>>>
+auto operator|(const predicate<L>& l, const predicate<R>& r) {
+  static_assert(
+    std::is_same_v<typename L::outer_type, typename R::outer_type>,
+    "predicate: combined predicates must refer to the same outer type"
+  );
+  return or_predicate<L, R>{l.self(), r.self()};
+}
+
+template<class P, class = std::enable_if_t<is_predicate_v<P>>>
+auto operator~(const predicate<P>& p) {
+  return not_predicate<P>{p.self()};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Entry point for building predicates from member handles:
+// ```
+// using ecrypa::where;
+// auto p = (where(item<0, Order>{}) == 42)
+//   & where(item<3, Order>{}).between(t0, t1)
+//   & ~where(item<1, Order>{}).in({"A", "B"});
+// ecrypa::selection s = ecrypa::scan(orders, p);
+// ```
+template<class Item>
+class where {
+ public:
+  using value_type = std::decay_t<typename Item::inner_type>;
+
+  constexpr explicit where(Item) {}
+
+  template<template<class> class Test>
+  using leaf = member_predicate<Item, Test<value_type>>;
+
+  auto operator==(value_type v) const { return leaf<equal_to_value>{{v}}; }
+  auto operator!=(value_type v) const { return leaf<not_equal_to_value>{{v}}; }
+  auto operator<(value_type v) const { return leaf<less_than_value>{{v}}; }
+  auto operator<=(value_type v) const { return leaf<less_equal_value>{{v}}; }
+  auto operator>(value_type v) const { return leaf<greater_than_value>{{v}}; }
+  auto operator>=(value_type v) const {
+    return leaf<greater_equal_value>{{v}};
+  }
+
+  auto between(value_type lo, value_type hi) const {
+    return leaf<between_values>{{std::move(lo), std::move(hi)}};
+  }
+
+  auto in(std::vector<value_type> values) const {
+    return leaf<in_values>{in_values<value_type>{std::move(values)}};
+  }
+  auto in(std::initializer_list<value_type> values) const {
+    return in(std::vector<value_type>(values));
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Evaluates `p` over a contiguous range of records.
+template<class Range, class P>
+selection scan(const Range& records, const predicate<P>& p) {
+  using Outer = typename P::outer_type;
+  const Outer* data = std::data(records);
+  const std::size_t size = std::size(records);
+
+  selection ret{size};
+  std::uint64_t* words = ret.words();
+  for(std::size_t i=0; i<size; i+=64) {
+    const std::size_t n = std::min<std::size_t>(64, size - i);
+    words[i / 64] = p.self().block(data + i, n);
+  }
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
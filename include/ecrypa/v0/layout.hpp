@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/names.hpp>
+#include <ecrypa/detail/utils.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class Outer>
+constexpr bool has_reference_members() {
+  return apply_members<Outer>([] (auto... ms) {
+    using std::is_reference_v;
+    return (false || ... || is_reference_v<typename decltype(ms)::inner_type>);
+  });
+}
+
+// Flat types may be copied bytewise and placed in files or shared memory:
+// trivially copyable, not polymorphic, and without reference members.
+template<class Outer>
+struct is_flat : std::bool_constant<
+  std::is_trivially_copyable_v<Outer>
+  && !std::is_polymorphic_v<Outer>
+  && !has_reference_members<Outer>()
+> {};
+
+template<class Outer>
+constexpr bool is_flat_v = is_flat<Outer>::value;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// `offsetof` for item handles (the zeroed storage is addressed, never read)
+template<class Item>
+std::size_t item_offset(Item item) {
+  using Outer = typename Item::outer_type;
+  static_assert(is_flat_v<Outer>, "item_offset: outer type must be flat");
+
+  alignas(Outer) static const unsigned char storage[sizeof(Outer)]{};
+  const Outer& outer = *reinterpret_cast<const Outer*>(storage);
+  const void* inner = std::addressof(item(outer));
+  return std::size_t(static_cast<const unsigned char*>(inner) - storage);
+}
+
+// whether `gather` reads `Item` at a stride: arithmetic members of flat
+// records
+template<class Item>
+constexpr bool is_strided_v =
+  Item::is_member
+  && !std::is_reference_v<typename Item::inner_type>
+  && std::is_arithmetic_v<std::decay_t<typename Item::inner_type>>
+  && is_flat_v<typename Item::outer_type>;
+
+// Copies `item(first[j])` into `out[j]` for `j < n`. Strided items are read
+// at their offset with a stride of `sizeof(Outer)`, a loop compilers
+// vectorize; other items are applied record by record.
+template<class Item>
+void gather(
+  Item item,
+  const typename Item::outer_type* first,
+  std::size_t n,
+  std::decay_t<typename Item::inner_type>* out
+) {
+  using Outer = typename Item::outer_type;
+  using Inner = std::decay_t<typename Item::inner_type>;
+
+  if constexpr(is_strided_v<Item>) {
+    auto p = reinterpret_cast<const unsigned char*>(first) + item_offset(item);
+    for(std::size_t j=0; j<n; ++j) {
+      std::memcpy(out + j, p + j * sizeof(Outer), sizeof(Inner));
+    }
+  }
+  else {
+    for(std::size_t j=0; j<n; ++j) out[j] = item(first[j]);
+  }
+}
+
+struct item_layout {
+  std::string_view name;
+  std::string_view type_name;
+  std::size_t offset;
+  std::size_t size;
+};
+
+template<class Item>
+item_layout make_item_layout(Item item) {
+  return {
+    item.inner_name(),
+    item.inner_type_name(),
+    item_offset(item),
+    sizeof(typename Item::inner_type)
+  };
+}
+
+template<class Outer>
+const auto& layout_of() {
+  static const auto ret = apply_items<Outer>([] (auto... bms) {
+    return std::array<item_layout, sizeof...(bms)>{make_item_layout(bms)...};
+  });
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Hash of the annotated shape: type name, size, and name, type name and size
+// of each item. Offsets are not constexpr and hence not part of it.
+template<class Outer>
+constexpr std::uint64_t make_fingerprint() {
+  std::uint64_t h = detail::fnv1a(std::string_view{type_name<Outer>()});
+  h = detail::fnv1a(std::uint64_t{sizeof(Outer)}, h);
+  each_item<Outer>([&] (auto bm) {
+    using Inner = std::remove_reference_t<typename decltype(bm)::inner_type>;
+    h = detail::fnv1a(std::string_view{bm.inner_name()}, h);
+    h = detail::fnv1a(bm.inner_type_name(), h);
+    h = detail::fnv1a(std::uint64_t{sizeof(Inner)}, h);
+  });
+  return h;
+}
+
+template<class Outer>
+constexpr std::uint64_t fingerprint = make_fingerprint<Outer>();
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/layout.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// File format (native endianness, everything at its natural alignment):
+// ```
+// mapped_file_header
+// mapped_file_item[item_count]      <- offset and size of each item
+// char names[names_size]            <- "name\0type name\0" for each item
+// padding up to `data_offset`
+// Outer data[capacity]
+// ```
+
+struct mapped_file_header {
+  char magic[8];
+  std::uint64_t fingerprint;
+  std::uint64_t record_size;
+  std::uint64_t record_align;
+  std::uint64_t item_count;
+  std::uint64_t names_size;
+  std::uint64_t data_offset;
+  std::uint64_t size;
+  std::uint64_t capacity;
+};
+
+struct mapped_file_item {
+  std::uint64_t offset;
+  std::uint64_t size;
+};
+
+class layout_mismatch : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+constexpr char mapped_magic[8] = {'e', 'c', 'r', 'y', 'p', 'a', 'm', 'v'};
+
+inline std::size_t round_up(std::size_t n, std::size_t align) {
+  return (n + align - 1) / align * align;
+}
+
+[[noreturn]] inline void throw_errno(const char* what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+template<class Outer>
+std::size_t mapped_names_size() {
+  std::size_t ret = 0;
+  for(const ::ecrypa::item_layout& il : ::ecrypa::layout_of<Outer>()) {
+    ret += il.name.size() + 1 + il.type_name.size() + 1;
+  }
+  return ret;
+}
+
+template<class Outer>
+std::size_t mapped_data_offset() {
+  constexpr std::size_t count = ::ecrypa::items<Outer>::count;
+  std::size_t n = sizeof(::ecrypa::mapped_file_header)
+    + count * sizeof(::ecrypa::mapped_file_item)
+    + mapped_names_size<Outer>();
+  return round_up(n, std::max<std::size_t>(alignof(Outer), 64));
+}
+
+// Writes the header, items and names of `Outer` to the start of a mapping
+// of at least `data_offset` zeroed bytes. The magic is written last, so that
+// other processes seeing it see the rest.
+template<class Outer>
+void write_mapped_layout(
+  unsigned char* base,
+  const char (&magic)[8],
+  std::size_t data_offset,
+  std::size_t capacity
+) {
+  const auto& layout = ::ecrypa::layout_of<Outer>();
+
+  ::ecrypa::mapped_file_header header{};
+  header.fingerprint = ::ecrypa::fingerprint<Outer>;
+  header.record_size = sizeof(Outer);
+  header.record_align = alignof(Outer);
+  header.item_count = layout.size();
+  header.names_size = mapped_names_size<Outer>();
+  header.data_offset = data_offset;
+  header.size = 0;
+  header.capacity = capacity;
+
+  unsigned char* p = base;
+  std::memcpy(p, &header, sizeof(header));
+  p += sizeof(header);
+  for(const ::ecrypa::item_layout& il : layout) {
+    ::ecrypa::mapped_file_item fi{il.offset, il.size};
+    std::memcpy(p, &fi, sizeof(fi));
+    p += sizeof(fi);
+  }
+  for(const ::ecrypa::item_layout& il : layout) {
+    for(std::string_view sv : {il.name, il.type_name}) {
+      std::memcpy(p, sv.data(), sv.size());
+      p += sv.size();
+      *p++ = '\0';
+    }
+  }
+
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(base, magic, sizeof(header.magic));
+}
+
+// Checks a mapping of `map_size` bytes written by `write_mapped_layout`
+// against the layout of `Outer`, with records `stride` bytes apart from
+// `data_offset`; throws `layout_mismatch` prefixed with `who`.
+template<class Outer>
+void validate_mapped_layout(
+  const unsigned char* base,
+  std::size_t map_size,
+  const char (&magic)[8],
+  std::size_t data_offset,
+  std::size_t stride,
+  const char* who
+) {
+  const auto& layout = ::ecrypa::layout_of<Outer>();
+  const auto mismatch = [&] (std::string what) {
+    throw ::ecrypa::layout_mismatch(who + what);
+  };
+
+  if(map_size < sizeof(::ecrypa::mapped_file_header)) {
+    mismatch("truncated header");
+  }
+
+  const auto& header =
+    *reinterpret_cast<const ::ecrypa::mapped_file_header*>(base);
+  if(std::memcmp(header.magic, magic, sizeof(header.magic))) {
+    mismatch("bad magic");
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(header.record_size != sizeof(Outer)) mismatch("record size differs");
+  if(header.record_align != alignof(Outer)) mismatch("alignment differs");
+  if(header.item_count != layout.size()) mismatch("item count differs");
+  if(header.names_size != mapped_names_size<Outer>()) {
+    mismatch("item names differ");
+  }
+  if(header.data_offset != data_offset) mismatch("data offset differs");
+  if(header.size > header.capacity
+     || header.data_offset > map_size
+     || header.capacity > (map_size - header.data_offset) / stride) {
+    mismatch("truncated data");
+  }
+
+  const unsigned char* p = base + sizeof(header);
+  const char* names = reinterpret_cast<const char*>(
+    p + layout.size() * sizeof(::ecrypa::mapped_file_item)
+  );
+  for(const ::ecrypa::item_layout& il : layout) {
+    ::ecrypa::mapped_file_item fi;
+    std::memcpy(&fi, p, sizeof(fi));
+    p += sizeof(fi);
+
+    std::string_view name{names};
+    names += name.size() + 1;
+    std::string_view type_name{names};
+    names += type_name.size() + 1;
+
+    if(name != il.name) {
+      mismatch("item `" + std::string(il.name) + "` was `"
+        + std::string(name) + "`");
+    }
+    if(type_name != il.type_name) {
+      mismatch("type of `" + std::string(il.name) + "` was `"
+        + std::string(type_name) + "`");
+    }
+    if(fi.offset != il.offset || fi.size != il.size) {
+      mismatch("placement of `" + std::string(il.name) + "` differs");
+    }
+  }
+  if(header.fingerprint != ::ecrypa::fingerprint<Outer>) {
+    mismatch("fingerprint differs");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A vector of flat annotated records backed by a shared file mapping. The file
+// starts with the annotated layout of `Outer`, which is checked on reopening;
+// the records themselves are used in place.
+template<class Outer>
+class mapped_vector {
+  static_assert(is_flat_v<Outer>, "mapped_vector: `Outer` must be flat");
+
+ public:
+  using value_type = Outer;
+  using size_type = std::size_t;
+  using iterator = Outer*;
+  using const_iterator = const Outer*;
+
+// opens `path`, or creates it with room for `capacity` records
+  explicit mapped_vector(const std::string& path, size_type capacity = 0) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd_ < 0) detail::throw_errno("mapped_vector: open");
+
+    struct stat st{};
+    if(::fstat(fd_, &st) != 0) {
+      close_();
+      detail::throw_errno("mapped_vector: fstat");
+    }
+
+    try {
+      if(st.st_size == 0) {
+        create_(std::max<size_type>(capacity, 1));
+      }
+      else {
+        map_(std::size_t(st.st_size));
+        validate_();
+      }
+    }
+    catch(...) {
+      unmap_();
+      close_();
+      throw;
+    }
+  }
+
+  mapped_vector(const mapped_vector&) = delete;
+  mapped_vector& operator=(const mapped_vector&) = delete;
+
+  mapped_vector(mapped_vector&& other) noexcept
+    : fd_{std::exchange(other.fd_, -1)}
+    , map_size_{std::exchange(other.map_size_, 0)}
+    , base_{std::exchange(other.base_, nullptr)}
+  {}
+
+  mapped_vector& operator=(mapped_vector&& other) noexcept {
+    if(this != &other) {
+      unmap_();
+      close_();
+      fd_ = std::exchange(other.fd_, -1);
+      map_size_ = std::exchange(other.map_size_, 0);
+      base_ = std::exchange(other.base_, nullptr);
+    }
+    return *this;
+  }
+
+  ~mapped_vector() {
+    unmap_();
+    close_();
+  }
+
+  size_type size() const { return header_().size; }
+  size_type capacity() const { return header_().capacity; }
+  bool empty() const { return size() == 0; }
+
+  Outer* data() { return reinterpret_cast<Outer*>(base_ + data_offset_()); }
+  const Outer* data() const {
+    return reinterpret_cast<const Outer*>(base_ + data_offset_());
+  }
+
+  iterator begin() { return data(); }
+  iterator end() { return data() + size(); }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size(); }
+
+  Outer& operator[](size_type i) { return data()[i]; }
+  const Outer& operator[](size_type i) const { return data()[i]; }
+
+  Outer& back() { return data()[size() - 1]; }
+  const Outer& back() const { return data()[size() - 1]; }
+
+  void reserve(size_type capacity) {
+    if(capacity <= this->capacity()) return;
+
+    std::size_t new_size = data_offset_() + capacity * sizeof(Outer);
+    if(::ftruncate(fd_, off_t(new_size)) != 0) {
+      detail::throw_errno("mapped_vector: ftruncate");
+    }
+    map_(new_size);
+    header_().capacity = capacity;
+  }
+
+  void push_back(const Outer& outer) {
+    if(size() == capacity()) reserve(2 * capacity());
+    std::memcpy(static_cast<void*>(data() + size()), &outer, sizeof(Outer));
+    ++header_().size;
+  }
+
+  void pop_back() { --header_().size; }
+  void clear() { header_().size = 0; }
+
+  void resize(size_type n, const Outer& value = Outer{}) {
+    reserve(n);
+    for(size_type i=size(); i<n; ++i) {
+      std::memcpy(static_cast<void*>(data() + i), &value, sizeof(Outer));
+    }
+    header_().size = n;
+  }
+
+// write dirty pages back to the file
+  void flush() {
+    if(::msync(base_, map_size_, MS_SYNC) != 0) {
+      detail::throw_errno("mapped_vector: msync");
+    }
+  }
+
+ private:
+  int fd_ = -1;
+  std::size_t map_size_ = 0;
+  unsigned char* base_ = nullptr;
+
+  mapped_file_header& header_() {
+    return *reinterpret_cast<mapped_file_header*>(base_);
+  }
+  const mapped_file_header& header_() const {
+    return *reinterpret_cast<const mapped_file_header*>(base_);
+  }
+  std::size_t data_offset_() const { return header_().data_offset; }
+
+// on failure the current mapping (if any) stays untouched
+  void map_(std::size_t size) {
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if(p == MAP_FAILED) detail::throw_errno("mapped_vector: mmap");
+    unmap_();
+    base_ = static_cast<unsigned char*>(p);
+    map_size_ = size;
+  }
+
+  void unmap_() {
+    if(base_ != nullptr) ::munmap(base_, map_size_);
+    base_ = nullptr;
+    map_size_ = 0;
+  }
+
+  void close_() {
+    if(fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+  }
+
+  void create_(size_type capacity) {
+    std::size_t data_offset = detail::mapped_data_offset<Outer>();
+    std::size_t file_size = data_offset + capacity * sizeof(Outer);
+
+    if(::ftruncate(fd_, off_t(file_size)) != 0) {
+      detail::throw_errno("mapped_vector: ftruncate");
+    }
+    map_(file_size);
+    detail::write_mapped_layout<Outer>(
+      base_, detail::mapped_magic, data_offset, capacity
+    );
+  }
+
+  void validate_() const {
+    detail::validate_mapped_layout<Outer>(
+      base_, map_size_, detail::mapped_magic,
+      detail::mapped_data_offset<Outer>(), sizeof(Outer), "mapped_vector: "
+    );
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
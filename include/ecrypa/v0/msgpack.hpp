@@ -0,0 +1,1017 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/reset.hpp>
+#include <ecrypa/v0/traits.hpp>
+#include <ecrypa/detail/utils.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+class msgpack_error : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// How annotated types are encoded: `map` from member names to values, with
+// members of bases inlined, or `array` of items by index, with bases as nested
+// arrays, for peers that share the schema. Decoding accepts both. Map mode
+// needs member names unique across bases; since the mode is chosen at run
+// time, a type whose bases repeat a name still compiles, and encoding or
+// decoding it as a map throws `msgpack_error`.
+enum class msgpack_mode { map, array };
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The writers below take any `Out` with `push_back(char)` and
+// `append(const char*, std::size_t)`, so they also run in constant
+// evaluation (see msgpack_constexpr.hpp).
+
+template<class Out, class U>
+constexpr void append_big_endian(Out& out, U u) {
+  char buf[sizeof(U)] = {};
+  for(std::size_t i=0; i<sizeof(U); ++i) {
+    buf[i] = char(u >> (8 * (sizeof(U) - 1 - i)));
+  }
+  out.append(buf, sizeof(U));
+}
+
+template<class Out>
+constexpr void append_msgpack_uint(Out& out, std::uint64_t u) {
+  if(u < 0x80) {
+    out.push_back(char(u));
+  }
+  else if(u <= 0xff) {
+    out.push_back(char(0xcc));
+    out.push_back(char(u));
+  }
+  else if(u <= 0xffff) {
+    out.push_back(char(0xcd));
+    append_big_endian(out, std::uint16_t(u));
+  }
+  else if(u <= 0xffffffff) {
+    out.push_back(char(0xce));
+    append_big_endian(out, std::uint32_t(u));
+  }
+  else {
+    out.push_back(char(0xcf));
+    append_big_endian(out, u);
+  }
+}
+
+template<class Out>
+constexpr void append_msgpack_int(Out& out, std::int64_t i) {
+  if(i >= 0) {
+    append_msgpack_uint(out, std::uint64_t(i));
+  }
+  else if(i >= -32) {
+    out.push_back(char(i));
+  }
+  else if(i >= INT8_MIN) {
+    out.push_back(char(0xd0));
+    out.push_back(char(i));
+  }
+  else if(i >= INT16_MIN) {
+    out.push_back(char(0xd1));
+    append_big_endian(out, std::uint16_t(i));
+  }
+  else if(i >= INT32_MIN) {
+    out.push_back(char(0xd2));
+    append_big_endian(out, std::uint32_t(i));
+  }
+  else {
+    out.push_back(char(0xd3));
+    append_big_endian(out, std::uint64_t(i));
+  }
+}
+
+// header of a str, array or map of `n` elements; `fix` is the fixstr,
+// fixarray or fixmap marker, `first16` the 16-bit variant (32 bits follow)
+template<class Out>
+constexpr void append_msgpack_header(
+  Out& out,
+  std::size_t n,
+  unsigned char fix,
+  std::size_t fix_limit,
+  unsigned char first16
+) {
+  if(n < fix_limit) {
+    out.push_back(char(fix | n));
+  }
+  else if(n <= 0xffff) {
+    out.push_back(char(first16));
+    append_big_endian(out, std::uint16_t(n));
+  }
+  else {
+    out.push_back(char(first16 + 1));
+    append_big_endian(out, std::uint32_t(n));
+  }
+}
+
+template<class Out>
+constexpr void append_msgpack_str_header(Out& out, std::size_t n) {
+  if(n < 32) {
+    out.push_back(char(0xa0 | n));
+  }
+  else if(n <= 0xff) {
+    out.push_back(char(0xd9));
+    out.push_back(char(n));
+  }
+  else {
+    append_msgpack_header(out, n, 0xa0, 0, 0xda);
+  }
+}
+
+template<class Out>
+constexpr void append_msgpack_str(Out& out, std::string_view s) {
+  append_msgpack_str_header(out, s.size());
+  out.append(s.data(), s.size());
+}
+
+template<class Out>
+constexpr void append_msgpack_array_header(Out& out, std::size_t n) {
+  append_msgpack_header(out, n, 0x90, 16, 0xdc);
+}
+
+template<class Out>
+constexpr void append_msgpack_map_header(Out& out, std::size_t n) {
+  append_msgpack_header(out, n, 0x80, 16, 0xde);
+}
+
+template<class Out>
+constexpr void append_msgpack_bin_header(Out& out, std::size_t n) {
+  if(n <= 0xff) {
+    out.push_back(char(0xc4));
+    out.push_back(char(n));
+  }
+  else {
+    append_msgpack_header(out, n, 0, 0, 0xc5);
+  }
+}
+
+struct msgpack_input {
+  const char* p;
+  const char* end;
+// decode into existing vector elements, resetting absent members
+  bool reuse = false;
+// arrays and maps being decoded, up to `max_depth`
+  std::size_t depth = 0;
+  static constexpr std::size_t max_depth = 512;
+
+// one level of nesting, for as long as it lives
+  class nested {
+   public:
+    explicit nested(msgpack_input& in) : in_{in} {
+      if(++in_.depth > max_depth) error("nesting too deep");
+    }
+    nested(const nested&) = delete;
+    nested& operator=(const nested&) = delete;
+    ~nested() { --in_.depth; }
+
+   private:
+    msgpack_input& in_;
+  };
+
+  [[noreturn]] static void error(const char* what) {
+    throw msgpack_error(std::string("msgpack: ") + what);
+  }
+
+  unsigned char byte() {
+    if(p == end) error("truncated input");
+    return static_cast<unsigned char>(*p++);
+  }
+
+  unsigned char peek() const {
+    if(p == end) error("truncated input");
+    return static_cast<unsigned char>(*p);
+  }
+
+  std::uint64_t big_endian(std::size_t n) {
+    if(std::size_t(end - p) < n) error("truncated input");
+    std::uint64_t v = 0;
+    for(std::size_t i=0; i<n; ++i) {
+      v = (v << 8) | static_cast<unsigned char>(p[i]);
+    }
+    p += n;
+    return v;
+  }
+
+  std::string_view bytes(std::size_t n) {
+    if(std::size_t(end - p) < n) error("truncated input");
+    std::string_view ret{p, n};
+    p += n;
+    return ret;
+  }
+
+// any integer format, as two's complement bits; `negative` if signed < 0
+  std::uint64_t integer(bool& negative) {
+    auto b = byte();
+    negative = false;
+    if(b < 0x80) return b;
+    if(b >= 0xe0) {
+      negative = true;
+      return std::uint64_t(std::int64_t(std::int8_t(b)));
+    }
+    switch(b) {
+      case 0xcc: return big_endian(1);
+      case 0xcd: return big_endian(2);
+      case 0xce: return big_endian(4);
+      case 0xcf: return big_endian(8);
+      case 0xd0: return signed_bits<std::int8_t>(big_endian(1), negative);
+      case 0xd1: return signed_bits<std::int16_t>(big_endian(2), negative);
+      case 0xd2: return signed_bits<std::int32_t>(big_endian(4), negative);
+      case 0xd3: return signed_bits<std::int64_t>(big_endian(8), negative);
+      default: error("expected integer");
+    }
+  }
+
+  template<class S>
+  static std::uint64_t signed_bits(std::uint64_t v, bool& negative) {
+    auto s = static_cast<S>(static_cast<std::make_unsigned_t<S>>(v));
+    negative = s < 0;
+    return std::uint64_t(std::int64_t(s));
+  }
+
+  std::string_view str() {
+    auto b = byte();
+    if((b & 0xe0) == 0xa0) return bytes(b & 0x1f);
+    switch(b) {
+      case 0xd9: return bytes(big_endian(1));
+      case 0xda: return bytes(big_endian(2));
+      case 0xdb: return bytes(big_endian(4));
+      default: error("expected string");
+    }
+  }
+
+  std::string_view bin() {
+    switch(byte()) {
+      case 0xc4: return bytes(big_endian(1));
+      case 0xc5: return bytes(big_endian(2));
+      case 0xc6: return bytes(big_endian(4));
+      default: error("expected bin");
+    }
+  }
+
+  std::size_t array_header() {
+    auto b = byte();
+    if((b & 0xf0) == 0x90) return b & 0x0f;
+    if(b == 0xdc) return big_endian(2);
+    if(b == 0xdd) return big_endian(4);
+    error("expected array");
+  }
+
+  bool is_map() const {
+    auto b = peek();
+    return (b & 0xf0) == 0x80 || b == 0xde || b == 0xdf;
+  }
+
+  std::size_t map_header() {
+    auto b = byte();
+    if((b & 0xf0) == 0x80) return b & 0x0f;
+    if(b == 0xde) return big_endian(2);
+    if(b == 0xdf) return big_endian(4);
+    error("expected map");
+  }
+
+// skips one value of any type, iteratively, so that deeply nested input
+// cannot exhaust the call stack
+  void skip() {
+    std::uint64_t pending = 1;// values still to skip
+    while(pending) {
+      --pending;
+      auto b = peek();
+      if(b < 0x80 || b >= 0xe0) {
+        ++p;
+      }
+      else if((b & 0xf0) == 0x80) {
+        pending += 2 * map_header();
+      }
+      else if((b & 0xf0) == 0x90) {
+        pending += array_header();
+      }
+      else if((b & 0xe0) == 0xa0) {
+        str();
+      }
+      else {
+        ++p;
+        pending += skip_other(b);
+      }
+      // every value takes at least one byte
+      if(pending > std::uint64_t(end - p)) error("truncated input");
+    }
+  }
+
+// skips the rest of the value of type byte `b`; returns the number of
+// nested values that follow
+  std::uint64_t skip_other(unsigned char b) {
+    switch(b) {
+      case 0xc0: case 0xc2: case 0xc3: return 0;
+      case 0xc4: bytes(big_endian(1)); return 0;
+      case 0xc5: bytes(big_endian(2)); return 0;
+      case 0xc6: bytes(big_endian(4)); return 0;
+      case 0xc7: bytes(big_endian(1) + 1); return 0;
+      case 0xc8: bytes(big_endian(2) + 1); return 0;
+      case 0xc9: bytes(big_endian(4) + 1); return 0;
+      case 0xca: bytes(4); return 0;
+      case 0xcb: bytes(8); return 0;
+      case 0xcc: case 0xd0: bytes(1); return 0;
+      case 0xcd: case 0xd1: bytes(2); return 0;
+      case 0xce: case 0xd2: bytes(4); return 0;
+      case 0xcf: case 0xd3: bytes(8); return 0;
+      case 0xd4: bytes(2); return 0;
+      case 0xd5: bytes(3); return 0;
+      case 0xd6: bytes(5); return 0;
+      case 0xd7: bytes(9); return 0;
+      case 0xd8: bytes(17); return 0;
+      case 0xd9: bytes(big_endian(1)); return 0;
+      case 0xda: bytes(big_endian(2)); return 0;
+      case 0xdb: bytes(big_endian(4)); return 0;
+      case 0xdc: return big_endian(2);
+      case 0xdd: return big_endian(4);
+      case 0xde: return 2 * big_endian(2);
+      case 0xdf: return 2 * big_endian(4);
+      default: error("invalid type byte");
+    }
+  }
+};
+
+// Contiguous payloads: strings (str) and byte buffers (bin), whose bytes are
+// written as they are in memory, and other sequences (array).
+template<class T>
+constexpr bool is_msgpack_str_v = false;
+template<class Traits, class Allocator>
+constexpr bool is_msgpack_str_v<std::basic_string<char, Traits, Allocator>>
+  = true;
+
+template<class T>
+constexpr bool is_msgpack_bin_v = false;
+template<class Allocator>
+constexpr bool is_msgpack_bin_v<std::vector<std::byte, Allocator>> = true;
+template<std::size_t N>
+constexpr bool is_msgpack_bin_v<std::array<std::byte, N>> = true;
+
+template<class T>
+constexpr bool is_msgpack_array_v = false;
+template<class T, class Allocator>
+constexpr bool is_msgpack_array_v<std::vector<T, Allocator>>
+  = !std::is_same_v<T, std::byte>;
+template<class T, std::size_t N>
+constexpr bool is_msgpack_array_v<std::array<T, N>>
+  = !std::is_same_v<T, std::byte>;
+
+// `std::vector<bool>`, whose elements are proxies rather than objects
+template<class T>
+constexpr bool is_msgpack_bits_v = false;
+template<class Allocator>
+constexpr bool is_msgpack_bits_v<std::vector<bool, Allocator>> = true;
+
+// fixed-size sequences, decoded in place rather than resized
+template<class T>
+constexpr bool is_msgpack_fixed_v = false;
+template<class T, std::size_t N>
+constexpr bool is_msgpack_fixed_v<std::array<T, N>> = true;
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// `msgpack_value<T>::encode(out, t, mode)` appends `t`;
+// `msgpack_value<T>::decode(in, t)` reads one value into `t`.
+// Specialize for more types.
+template<class T, class ExpressionSfinae = void>
+struct msgpack_value;
+
+template<>
+struct msgpack_value<bool> {
+  static void encode(std::string& out, bool b, msgpack_mode) {
+    out.push_back(char(b ? 0xc3 : 0xc2));
+  }
+  static void decode(detail::msgpack_input& in, bool& b) {
+    auto byte = in.byte();
+    if(byte != 0xc2 && byte != 0xc3) in.error("expected bool");
+    b = byte == 0xc3;
+  }
+};
+
+// integers and enums in their shortest encoding
+template<class T>
+struct msgpack_value<
+  T,
+  std::enable_if_t<
+    (std::is_integral_v<T> && !std::is_same_v<T, bool>) || std::is_enum_v<T>
+  >
+> {
+  using I = std::conditional_t<
+    std::is_enum_v<T>, std::underlying_type<T>, std::common_type<T>
+  >;
+  using Int = typename I::type;
+
+  static void encode(std::string& out, T t, msgpack_mode) {
+    if constexpr(std::is_signed_v<Int>) {
+      detail::append_msgpack_int(out, std::int64_t(Int(t)));
+    }
+    else {
+      detail::append_msgpack_uint(out, std::uint64_t(Int(t)));
+    }
+  }
+  static void decode(detail::msgpack_input& in, T& t) {
+    bool negative;
+    auto bits = in.integer(negative);
+    if(negative && std::is_unsigned_v<Int>) in.error("negative for unsigned");
+    constexpr auto max = std::uint64_t(std::numeric_limits<Int>::max());
+    if(negative) {
+      constexpr auto min = std::int64_t(std::numeric_limits<Int>::min());
+      if(std::int64_t(bits) < min) in.error("integer out of range");
+    }
+    else if(bits > max) {
+      in.error("integer out of range");
+    }
+    t = static_cast<T>(static_cast<Int>(bits));
+  }
+};
+
+template<class T>
+struct msgpack_value<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  static void encode(std::string& out, T t, msgpack_mode) {
+    if constexpr(sizeof(T) == 4) {
+      std::uint32_t u;
+      std::memcpy(&u, &t, 4);
+      out.push_back(char(0xca));
+      detail::append_big_endian(out, u);
+    }
+    else {
+      double d = double(t);
+      std::uint64_t u;
+      std::memcpy(&u, &d, 8);
+      out.push_back(char(0xcb));
+      detail::append_big_endian(out, u);
+    }
+  }
+  static void decode(detail::msgpack_input& in, T& t) {
+    auto b = in.peek();
+    if(b == 0xca) {
+      ++in.p;
+      auto u = std::uint32_t(in.big_endian(4));
+      float f;
+      std::memcpy(&f, &u, 4);
+      t = T(f);
+    }
+    else if(b == 0xcb) {
+      ++in.p;
+      auto u = in.big_endian(8);
+      double d;
+      std::memcpy(&d, &u, 8);
+      t = T(d);
+    }
+    else {
+      bool negative;
+      auto bits = in.integer(negative);
+      t = negative ? T(std::int64_t(bits)) : T(bits);
+    }
+  }
+};
+
+template<class Traits, class Allocator>
+struct msgpack_value<std::basic_string<char, Traits, Allocator>> {
+  using T = std::basic_string<char, Traits, Allocator>;
+
+  static void encode(std::string& out, const T& t, msgpack_mode) {
+    detail::append_msgpack_str(out, t);
+  }
+  static void decode(detail::msgpack_input& in, T& t) {
+    auto s = in.str();
+    t.assign(s.data(), s.size());
+  }
+};
+
+// decodes to a view into the message, which must outlive it
+template<>
+struct msgpack_value<std::string_view> {
+  static void encode(std::string& out, std::string_view s, msgpack_mode) {
+    detail::append_msgpack_str(out, s);
+  }
+  static void decode(detail::msgpack_input& in, std::string_view& s) {
+    s = in.str();
+  }
+};
+
+template<class T, class Allocator>
+struct msgpack_value<std::vector<T, Allocator>> {
+  static void encode(
+    std::string& out, const std::vector<T, Allocator>& v, msgpack_mode mode
+  ) {
+    detail::append_msgpack_array_header(out, v.size());
+    for(const T& t : v) msgpack_value<T>::encode(out, t, mode);
+  }
+  static void decode(
+    detail::msgpack_input& in, std::vector<T, Allocator>& v
+  ) {
+    const detail::msgpack_input::nested nested{in};
+    const auto n = in.array_header();
+    if(!in.reuse) v.clear();
+    if(n < v.size()) v.erase(v.begin() + std::ptrdiff_t(n), v.end());
+    v.reserve(std::min<std::size_t>(n, std::size_t(in.end - in.p)));
+    for(std::size_t i=0; i<n; ++i) {
+      msgpack_value<T>::decode(in, i < v.size() ? v[i] : v.emplace_back());
+    }
+  }
+};
+
+// elements of `std::vector<bool>` cannot be decoded in place
+template<class Allocator>
+struct msgpack_value<std::vector<bool, Allocator>> {
+  static void encode(
+    std::string& out, const std::vector<bool, Allocator>& v, msgpack_mode mode
+  ) {
+    detail::append_msgpack_array_header(out, v.size());
+    for(bool b : v) msgpack_value<bool>::encode(out, b, mode);
+  }
+  static void decode(
+    detail::msgpack_input& in, std::vector<bool, Allocator>& v
+  ) {
+    const auto n = in.array_header();
+    v.clear();
+    v.reserve(std::min<std::size_t>(n, std::size_t(in.end - in.p)));
+    for(std::size_t i=0; i<n; ++i) {
+      bool b = false;
+      msgpack_value<bool>::decode(in, b);
+      v.push_back(b);
+    }
+  }
+};
+
+template<class T, std::size_t N>
+struct msgpack_value<std::array<T, N>> {
+  static void encode(
+    std::string& out, const std::array<T, N>& a, msgpack_mode mode
+  ) {
+    detail::append_msgpack_array_header(out, N);
+    for(const T& t : a) msgpack_value<T>::encode(out, t, mode);
+  }
+  static void decode(detail::msgpack_input& in, std::array<T, N>& a) {
+    const detail::msgpack_input::nested nested{in};
+    if(in.array_header() != N) in.error("array size mismatch");
+    for(T& t : a) msgpack_value<T>::decode(in, t);
+  }
+};
+
+// byte buffers as bin
+template<class Allocator>
+struct msgpack_value<std::vector<std::byte, Allocator>> {
+  using T = std::vector<std::byte, Allocator>;
+
+  static void encode(std::string& out, const T& v, msgpack_mode) {
+    detail::append_msgpack_bin_header(out, v.size());
+    out.append(reinterpret_cast<const char*>(v.data()), v.size());
+  }
+  static void decode(detail::msgpack_input& in, T& v) {
+    auto s = in.bin();
+    v.resize(s.size());
+    if(!s.empty()) std::memcpy(v.data(), s.data(), s.size());
+  }
+};
+
+template<std::size_t N>
+struct msgpack_value<std::array<std::byte, N>> {
+  using T = std::array<std::byte, N>;
+
+  static void encode(std::string& out, const T& a, msgpack_mode) {
+    detail::append_msgpack_bin_header(out, N);
+    out.append(reinterpret_cast<const char*>(a.data()), N);
+  }
+  static void decode(detail::msgpack_input& in, T& a) {
+    auto s = in.bin();
+    if(s.size() != N) in.error("bin size mismatch");
+    if(N) std::memcpy(a.data(), s.data(), N);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// `Items...` applied left to right: a member reached through bases
+template<class... Items>
+struct item_path {
+  template<class T>
+  static constexpr decltype(auto) get(T& t) { return t; }
+};
+
+template<class First, class... Rest>
+struct item_path<First, Rest...> {
+  using last_item =
+    std::tuple_element_t<sizeof...(Rest), std::tuple<First, Rest...>>;
+
+  template<class T>
+  static constexpr decltype(auto) get(T& t) {
+    return item_path<Rest...>::get(First{}(t));
+  }
+};
+
+template<class Outer, class... Prefix>
+constexpr auto member_paths(item_path<Prefix...>);
+
+template<class... Prefix, class Item>
+constexpr auto member_paths_of(item_path<Prefix...>, Item) {
+  if constexpr(Item::is_base) {
+    using Base = typename Item::inner_type;
+    return member_paths<Base>(item_path<Prefix..., Item>{});
+  }
+  else {
+    return std::tuple<item_path<Prefix..., Item>>{};
+  }
+}
+
+// the members of `Outer` and its bases, depth first, as `item_path`s
+template<class Outer, class... Prefix>
+constexpr auto member_paths(item_path<Prefix...> prefix) {
+  return apply_items<Outer>([&] (auto... bms) {
+    return std::tuple_cat(member_paths_of(prefix, bms)...);
+  });
+}
+
+template<class Outer>
+using member_paths_t = decltype(member_paths<Outer>(item_path<>{}));
+
+constexpr std::size_t const_strlen(const char* s) {
+  std::size_t n = 0;
+  while(s[n]) ++n;
+  return n;
+}
+
+// msgpack str encoding of a member name, built at compile time
+template<class Item>
+struct msgpack_key {
+  static constexpr std::size_t length = const_strlen(Item::inner_name());
+  static constexpr std::size_t header = length < 32 ? 1 : 2;
+  static_assert(length <= 0xff, "msgpack: member name too long");
+
+  static constexpr std::array<char, header + length> make_bytes() {
+    std::array<char, header + length> ret{};
+    if(header == 1) {
+      ret[0] = char(0xa0 | length);
+    }
+    else {
+      ret[0] = char(0xd9);
+      ret[1] = char(length);
+    }
+    for(std::size_t i=0; i<length; ++i) ret[header + i] = Item::inner_name()[i];
+    return ret;
+  }
+  static constexpr auto bytes = make_bytes();
+
+  static constexpr std::string_view view() {
+    return {bytes.data(), bytes.size()};
+  }
+  static constexpr std::string_view name() {
+    return {bytes.data() + header, length};
+  }
+};
+
+constexpr std::uint64_t msgpack_key_hash(
+  std::string_view s, std::uint64_t seed
+) {
+  auto h = fnv1a(s, fnv1a_init ^ seed);
+  return h ^ (h >> 29);
+}
+
+template<class Outer>
+using msgpack_decode_fn = void (*)(msgpack_input&, Outer&);
+
+template<class Outer, class Path>
+void decode_msgpack_member(msgpack_input& in, Outer& outer) {
+  using Target = decltype(Path::get(outer));
+  using Inner = std::remove_reference_t<Target>;
+  if constexpr(std::is_lvalue_reference_v<Target> && !std::is_const_v<Inner>) {
+    msgpack_value<std::decay_t<Inner>>::decode(in, Path::get(outer));
+  }
+  else {
+    in.skip();// not assignable
+  }
+}
+
+template<class Outer, class Path>
+void reset_msgpack_member(Outer& outer) {
+  using Target = decltype(Path::get(outer));
+  using Inner = std::remove_reference_t<Target>;
+  if constexpr(std::is_lvalue_reference_v<Target> && !std::is_const_v<Inner>) {
+    ::ecrypa::reset(Path::get(outer));
+  }
+}
+
+// Member names of `Outer` with the members of bases inlined, as in map mode.
+template<class Outer>
+struct msgpack_member_names {
+  using Paths = member_paths_t<Outer>;
+  static constexpr std::size_t count = std::tuple_size_v<Paths>;
+
+  template<std::size_t... is>
+  static constexpr std::array<std::string_view, count> make_names(
+    std::index_sequence<is...>
+  ) {
+    return {msgpack_key<
+      typename std::tuple_element_t<is, Paths>::last_item
+    >::name()...};
+  }
+  static constexpr auto names = make_names(std::make_index_sequence<count>{});
+
+  static constexpr bool make_unique() {
+    for(std::size_t i=0; i<count; ++i) {
+      for(std::size_t j=0; j<i; ++j) {
+        if(names[i] == names[j]) return false;
+      }
+    }
+    return true;
+  }
+// false if bases repeat member names; such types only work in array mode
+  static constexpr bool unique = make_unique();
+};
+
+// Decoders by member name for map mode, instantiated by the first map
+// decoded into `Outer`. Up to `perfect_limit` members, a seed and a
+// power-of-two table size are searched at compile time such that no two
+// names share a slot, and lookup hashes the key once and compares one name.
+// Larger types, or those for which the search fails, use a table sorted by
+// name and a binary search.
+template<class Outer>
+struct msgpack_map_decoders : msgpack_member_names<Outer> {
+  using typename msgpack_member_names<Outer>::Paths;
+  using msgpack_member_names<Outer>::count;
+  using msgpack_member_names<Outer>::names;
+  using msgpack_member_names<Outer>::unique;
+
+  static constexpr std::size_t perfect_limit = 32;
+  static constexpr std::size_t max_size = 256;
+
+  struct slot {
+    std::string_view name;
+    msgpack_decode_fn<Outer> decode;
+    std::size_t index;// into `Paths`
+  };
+
+  static constexpr bool distinct(std::size_t size, std::uint64_t seed) {
+    std::array<bool, max_size> used{};
+    for(auto name : names) {
+      auto s = std::size_t(msgpack_key_hash(name, seed) & (size - 1));
+      if(used[s]) return false;
+      used[s] = true;
+    }
+    return true;
+  }
+
+  // smallest table first, then seeds; {0, 0} if none is found
+  static constexpr std::pair<std::size_t, std::uint64_t> search() {
+    if(!unique || count > perfect_limit) return {0, 0};
+    std::size_t size = 1;
+    while(size < count) size *= 2;
+    for(; size <= max_size; size *= 2) {
+      for(std::uint64_t seed=0; seed<64; ++seed) {
+        if(distinct(size, seed)) return {size, seed};
+      }
+    }
+    return {0, 0};
+  }
+  static constexpr auto found = search();
+  static constexpr bool perfect = found.first != 0;
+  static constexpr std::size_t size = perfect ? found.first : count;
+  static constexpr std::uint64_t seed = found.second;
+
+  template<std::size_t... is>
+  static constexpr std::array<slot, size> make_table(
+    std::index_sequence<is...>
+  ) {
+    std::array<slot, size> ret{};
+    if constexpr(perfect) {
+      (..., (ret[msgpack_key_hash(names[is], seed) & (size - 1)] = slot{
+        names[is],
+        &decode_msgpack_member<Outer, std::tuple_element_t<is, Paths>>,
+        is
+      }));
+    }
+    else {
+      (..., (ret[is] = slot{
+        names[is],
+        &decode_msgpack_member<Outer, std::tuple_element_t<is, Paths>>,
+        is
+      }));
+      for(std::size_t i=1; i<size; ++i) {// insertion sort by name
+        for(std::size_t j=i; j>0 && ret[j].name < ret[j - 1].name; --j) {
+          slot t = ret[j];
+          ret[j] = ret[j - 1];
+          ret[j - 1] = t;
+        }
+      }
+    }
+    return ret;
+  }
+  static constexpr auto table = unique
+    ? make_table(std::make_index_sequence<count>{})
+    : std::array<slot, size>{};
+
+  static const slot* find_slot(std::string_view name) {
+    if constexpr(perfect) {
+      const slot& s = table[msgpack_key_hash(name, seed) & (size - 1)];
+      return s.decode && s.name == name ? &s : nullptr;
+    }
+    else {
+      auto it = std::lower_bound(
+        table.begin(), table.end(), name,
+        [] (const slot& s, std::string_view n) { return s.name < n; }
+      );
+      return it != table.end() && it->name == name ? &*it : nullptr;
+    }
+  }
+
+  static msgpack_decode_fn<Outer> find(std::string_view name) {
+    const slot* s = find_slot(name);
+    return s ? s->decode : nullptr;
+  }
+};
+
+template<class Outer>
+void encode_msgpack_map(
+  std::string& out, const Outer& outer, msgpack_mode mode
+) {
+  using Paths = member_paths_t<Outer>;
+  if(!msgpack_member_names<Outer>::unique) {
+    msgpack_input::error("member names repeat across bases, use array mode");
+  }
+  append_msgpack_map_header(out, std::tuple_size_v<Paths>);
+  std::apply([&] (auto... paths) {
+    (..., [&] (auto path) {
+      using Path = decltype(path);
+      using Item = typename Path::last_item;
+      using Inner = std::decay_t<typename Item::inner_type>;
+      out.append(msgpack_key<Item>::view());
+      msgpack_value<Inner>::encode(out, Path::get(outer), mode);
+    }(paths));
+  }, Paths{});
+}
+
+template<class Outer>
+void encode_msgpack_array(
+  std::string& out, const Outer& outer, msgpack_mode mode
+) {
+  append_msgpack_array_header(out, items<Outer>::count);
+  each_item<Outer>([&] (auto bm) {
+    using Inner = std::decay_t<typename decltype(bm)::inner_type>;
+    msgpack_value<Inner>::encode(out, bm(outer), mode);
+  });
+}
+
+template<class Outer, std::size_t... is>
+void reset_unseen_members(
+  Outer& outer,
+  const std::array<bool, sizeof...(is)>& seen,
+  std::index_sequence<is...>
+) {
+  using Paths = member_paths_t<Outer>;
+  (..., (
+    seen[is] || (reset_msgpack_member<Outer, std::tuple_element_t<is, Paths>>(
+      outer
+    ), true)
+  ));
+}
+
+template<class Outer>
+void decode_msgpack_object(msgpack_input& in, Outer& outer) {
+  const msgpack_input::nested nested{in};
+  if(in.is_map()) {
+    if(!msgpack_member_names<Outer>::unique) {
+      in.error("member names repeat across bases, use array mode");
+    }
+    using Decoders = msgpack_map_decoders<Outer>;
+    std::array<bool, Decoders::count> seen{};
+    for(auto n = in.map_header(); n; --n) {
+      auto slot = Decoders::find_slot(in.str());
+      if(slot) {
+        slot->decode(in, outer);
+        seen[slot->index] = true;
+      }
+      else {
+        in.skip();
+      }
+    }
+    if(in.reuse) {
+      reset_unseen_members(
+        outer, seen, std::make_index_sequence<Decoders::count>{}
+      );
+    }
+  }
+  else {
+    const auto n = in.array_header();
+    std::size_t i = 0;
+    each_item<Outer>([&] (auto bm) {
+      using Path = item_path<decltype(bm)>;
+      if(i++ < n) decode_msgpack_member<Outer, Path>(in, outer);
+      else if(in.reuse) reset_msgpack_member<Outer, Path>(outer);
+    });
+    for(; i < n; ++i) in.skip();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class T>
+struct msgpack_value<T, std::enable_if_t<is_annotated<T>{}>> {
+  static void encode(std::string& out, const T& t, msgpack_mode mode) {
+    if(mode == msgpack_mode::map) detail::encode_msgpack_map(out, t, mode);
+    else detail::encode_msgpack_array(out, t, mode);
+  }
+  static void decode(detail::msgpack_input& in, T& t) {
+    detail::decode_msgpack_object(in, t);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class Outer>
+void encode_msgpack(
+  std::string& out, const Outer& outer, msgpack_mode mode = msgpack_mode::map
+) {
+  msgpack_value<Outer>::encode(out, outer, mode);
+}
+
+template<class Outer>
+std::string to_msgpack(
+  const Outer& outer, msgpack_mode mode = msgpack_mode::map
+) {
+  std::string ret;
+  encode_msgpack(ret, outer, mode);
+  return ret;
+}
+
+// Reads one value into `outer`. Maps are matched by member name (unknown
+// keys are skipped), arrays by item index; members not present are left
+// alone. Throws `msgpack_error` on malformed input, and on a map for a type
+// whose bases repeat member names (see `msgpack_mode`).
+template<class Outer>
+void decode_msgpack(std::string_view message, Outer& outer) {
+  detail::msgpack_input in{message.data(), message.data() + message.size()};
+  msgpack_value<Outer>::decode(in, outer);
+}
+
+// Like `decode_msgpack` into a `reset` object, but keeping the buffers that
+// `outer` holds: vectors are decoded into their existing elements and
+// strings into their existing storage, and members absent from the message
+// are reset. A pooled object decoded this way allocates only when a message
+// outgrows it (vectors destroy the elements a shorter message leaves over).
+template<class Outer>
+void decode_msgpack_reuse(std::string_view message, Outer& outer) {
+  detail::msgpack_input in{message.data(), message.data() + message.size()};
+  in.reuse = true;
+  msgpack_value<Outer>::decode(in, outer);
+}
+
+template<class Outer>
+Outer from_msgpack(std::string_view message) {
+  Outer ret{};
+  decode_msgpack(message, ret);
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/msgpack.hpp>
+#include <ecrypa/v0/traits.hpp>
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Output of the constant-evaluated encoder: counts bytes, and stores them
+// too if `data` is set.
+struct constexpr_output {
+  char* data = nullptr;
+  std::size_t size = 0;
+
+  constexpr void push_back(char c) {
+    if(data) data[size] = c;
+    ++size;
+  }
+  constexpr void append(const char* p, std::size_t n) {
+    for(std::size_t i=0; i<n; ++i) push_back(p[i]);
+  }
+};
+
+template<class T>
+constexpr bool constexpr_msgpack_encodable_v = false;
+
+// the encoding of `msgpack_value<T>::encode`, restricted to literal types:
+// bool, arithmetic types, enums, `std::string_view`, `std::array` and
+// annotated types composed of these
+template<class T>
+constexpr void encode_msgpack_constexpr(
+  constexpr_output& out, const T& t, msgpack_mode mode
+) {
+  if constexpr(std::is_same_v<T, bool>) {
+    out.push_back(char(t ? 0xc3 : 0xc2));
+  }
+  else if constexpr(std::is_enum_v<T>) {
+    using U = std::underlying_type_t<T>;
+    encode_msgpack_constexpr(out, static_cast<U>(t), mode);
+  }
+  else if constexpr(std::is_integral_v<T>) {
+    if constexpr(std::is_signed_v<T>) append_msgpack_int(out, t);
+    else append_msgpack_uint(out, t);
+  }
+  else if constexpr(std::is_floating_point_v<T>) {
+    if constexpr(sizeof(T) == 4) {
+      out.push_back(char(0xca));
+      append_big_endian(out, __builtin_bit_cast(std::uint32_t, t));
+    }
+    else {
+      out.push_back(char(0xcb));
+      append_big_endian(out, __builtin_bit_cast(std::uint64_t, double(t)));
+    }
+  }
+  else if constexpr(std::is_same_v<T, std::string_view>) {
+    append_msgpack_str(out, t);
+  }
+  else if constexpr(is_msgpack_bin_v<T> && is_msgpack_fixed_v<T>) {
+    append_msgpack_bin_header(out, t.size());
+    for(std::byte b : t) out.push_back(char(b));
+  }
+  else if constexpr(is_msgpack_fixed_v<T>) {
+    append_msgpack_array_header(out, t.size());
+    for(const auto& e : t) encode_msgpack_constexpr(out, e, mode);
+  }
+  else if constexpr(is_annotated<T>{}) {
+    if(mode == msgpack_mode::map) {
+      using Paths = member_paths_t<T>;
+      if(!msgpack_member_names<T>::unique) {
+        msgpack_input::error(
+          "member names repeat across bases, use array mode"
+        );
+      }
+      append_msgpack_map_header(out, std::tuple_size_v<Paths>);
+      std::apply([&] (auto... paths) {
+        (..., [&] (auto path) {
+          using Path = decltype(path);
+          auto key = msgpack_key<typename Path::last_item>::view();
+          out.append(key.data(), key.size());
+          encode_msgpack_constexpr(out, Path::get(t), mode);
+        }(paths));
+      }, Paths{});
+    }
+    else {
+      append_msgpack_array_header(out, items<T>::count);
+      each_item<T>([&] (auto bm) {
+        encode_msgpack_constexpr(out, bm(t), mode);
+      });
+    }
+  }
+  else {
+    static_assert(
+      constexpr_msgpack_encodable_v<T>,
+      "encode_msgpack_constexpr: not a supported literal type"
+    );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Size of `encode_msgpack(t, mode)`, computed in constant evaluation for
+// the literal types of `serialize_to_array`.
+template<class T>
+constexpr std::size_t msgpack_size(
+  const T& t, msgpack_mode mode = msgpack_mode::map
+) {
+  detail::constexpr_output out;
+  detail::encode_msgpack_constexpr(out, t, mode);
+  return out.size;
+}
+
+// The MessagePack encoding of `value` as a `std::array`, at compile time:
+// ```
+// constexpr Config default_config{...};
+// constexpr auto blob = ecrypa::serialize_to_array<default_config>();
+// auto config = ecrypa::from_msgpack<Config>({blob.data(), blob.size()});
+// ```
+// Bytes equal those of `encode_msgpack` at run time. `value` must have static
+// storage duration; strings are held as `std::string_view`, which decodes to
+// views into the blob.
+template<const auto& value, msgpack_mode mode = msgpack_mode::map>
+constexpr auto serialize_to_array() {
+  constexpr std::size_t size = msgpack_size(value, mode);
+  std::array<char, size> ret{};
+  detail::constexpr_output out{ret.data()};
+  detail::encode_msgpack_constexpr(out, value, mode);
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
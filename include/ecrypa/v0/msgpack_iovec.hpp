@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+
+#include <algorithm>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/msgpack.hpp>
+#include <ecrypa/v0/traits.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Encodes values like `encode_msgpack`, but as a list of `iovec`s for
+// `writev` or io_uring instead of one buffer: headers and scalars are copied
+// into a scratch buffer, while the payloads of strings and byte buffers of at
+// least `min_reference_size` bytes are pointed at in place.
+// ```
+// ecrypa::msgpack_iovec out;
+// for(const Record& r : batch) out.encode(r);
+// out.write_all(fd);
+// ```
+// Encoded values must outlive the `iovec`s and stay unmodified.
+class msgpack_iovec {
+ public:
+  explicit msgpack_iovec(std::size_t min_reference_size = 512)
+    : min_reference_size_{min_reference_size} {}
+
+// appends the encoding of `outer`
+  template<class Outer>
+  void encode(const Outer& outer, msgpack_mode mode = msgpack_mode::map) {
+    put(outer, mode);
+  }
+
+// total bytes encoded
+  std::size_t size() const { return scratch_.size() + referenced_; }
+
+// valid until the next call to `encode` or `clear`
+  const std::vector<iovec>& iovecs() {
+    close_run();
+    iovecs_.clear();
+    for(const segment& s : segments_) {
+      const char* base = s.data ? s.data : scratch_.data() + s.offset;
+      iovecs_.push_back({const_cast<char*>(base), s.size});
+    }
+    return iovecs_;
+  }
+
+  void clear() {
+    scratch_.clear();
+    segments_.clear();
+    run_ = 0;
+    referenced_ = 0;
+  }
+
+// writes everything to `fd`, at most `IOV_MAX` `iovec`s per `writev` and
+// resuming after partial writes; throws `std::system_error`
+  void write_all(int fd) {
+    iovecs();
+    iovec* v = iovecs_.data();
+    std::size_t i = 0;
+    const std::size_t n = iovecs_.size();
+    while(i < n) {
+      const auto count = std::min<std::size_t>(n - i, IOV_MAX);
+      const auto written = ::writev(fd, v + i, int(count));
+      if(written < 0) {
+        if(errno == EINTR) continue;
+        throw std::system_error(
+          errno, std::generic_category(), "msgpack_iovec: writev"
+        );
+      }
+      auto w = std::size_t(written);
+      for(; i < n && w >= v[i].iov_len; ++i) w -= v[i].iov_len;
+      if(w) {
+        v[i].iov_base = static_cast<char*>(v[i].iov_base) + w;
+        v[i].iov_len -= w;
+      }
+    }
+  }
+
+ private:
+// referenced bytes at `data`, or scratch bytes at `offset` if `data` is null
+  struct segment {
+    const char* data;
+    std::size_t offset;
+    std::size_t size;
+  };
+
+  std::size_t min_reference_size_;
+  std::string scratch_;
+  std::vector<segment> segments_;
+  std::vector<iovec> iovecs_;
+// start of the scratch bytes not yet in a segment
+  std::size_t run_ = 0;
+  std::size_t referenced_ = 0;
+
+  void close_run() {
+    if(run_ == scratch_.size()) return;
+    segments_.push_back({nullptr, run_, scratch_.size() - run_});
+    run_ = scratch_.size();
+  }
+
+  void append_bytes(const void* data, std::size_t size) {
+    auto p = static_cast<const char*>(data);
+    if(size < min_reference_size_) {
+      scratch_.append(p, size);
+      return;
+    }
+    close_run();
+    segments_.push_back({p, 0, size});
+    referenced_ += size;
+  }
+
+  template<class T>
+  void put(const T& t, msgpack_mode mode) {
+    if constexpr(detail::is_msgpack_str_v<T>) {
+      detail::append_msgpack_str_header(scratch_, t.size());
+      append_bytes(t.data(), t.size());
+    }
+    else if constexpr(detail::is_msgpack_bin_v<T>) {
+      detail::append_msgpack_bin_header(scratch_, t.size());
+      append_bytes(t.data(), t.size());
+    }
+    else if constexpr(detail::is_msgpack_array_v<T>) {
+      using Element = typename T::value_type;
+      if constexpr(std::is_arithmetic_v<Element> || std::is_enum_v<Element>) {
+        msgpack_value<T>::encode(scratch_, t, mode);
+      }
+      else {
+        detail::append_msgpack_array_header(scratch_, t.size());
+        for(const Element& e : t) put(e, mode);
+      }
+    }
+    else if constexpr(is_annotated<T>{}) {
+      if(mode == msgpack_mode::map) put_map(t, mode);
+      else put_array(t, mode);
+    }
+    else {
+      msgpack_value<T>::encode(scratch_, t, mode);
+    }
+  }
+
+  template<class Outer>
+  void put_map(const Outer& outer, msgpack_mode mode) {
+    using Paths = detail::member_paths_t<Outer>;
+    if(!detail::msgpack_member_names<Outer>::unique) {
+      detail::msgpack_input::error(
+        "member names repeat across bases, use array mode"
+      );
+    }
+    detail::append_msgpack_map_header(scratch_, std::tuple_size_v<Paths>);
+    std::apply([&] (auto... paths) {
+      (..., [&] (auto path) {
+        using Path = decltype(path);
+        using Item = typename Path::last_item;
+        scratch_.append(detail::msgpack_key<Item>::view());
+        put(Path::get(outer), mode);
+      }(paths));
+    }, Paths{});
+  }
+
+  template<class Outer>
+  void put_array(const Outer& outer, msgpack_mode mode) {
+    detail::append_msgpack_array_header(scratch_, items<Outer>::count);
+    each_item<Outer>([&] (auto bm) { put(bm(outer), mode); });
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,628 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/msgpack.hpp>
+#include <ecrypa/v0/traits.hpp>
+
+// Resumable MessagePack encoding and decoding in bounded chunks. Both sides
+// keep an explicit stack of frames (one per open object, vector or string)
+// instead of the call stack, so they can stop at any byte and resume later;
+// memory stays constant regardless of the size of the encoding.
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Produces the bytes of `encode_msgpack(outer, mode)` a chunk at a time:
+// ```
+// ecrypa::msgpack_encoder encoder{order};
+// char chunk[4096];
+// while(!encoder.done()) send(chunk, encoder.write_some(chunk, sizeof(chunk)));
+// ```
+// Strings and byte buffers are copied straight from `outer`, which must
+// outlive the encoder and stay unmodified. `std::vector<bool>` and types with
+// user-provided `msgpack_value` specializations are encoded whole into a
+// scratch buffer. In map mode, `write_some` throws `msgpack_error` on a type
+// whose bases repeat member names (see `msgpack_mode`).
+class msgpack_encoder {
+ public:
+  template<class Outer>
+  explicit msgpack_encoder(
+    const Outer& outer, msgpack_mode mode = msgpack_mode::map
+  ) : mode_{mode} {
+    push<Outer>(&outer);
+  }
+
+  bool done() const { return stack_.empty() && pending_size_ == 0; }
+
+// writes up to `size` bytes to `out` and returns their count, which is less
+// than `size` only once done
+  std::size_t write_some(char* out, std::size_t size) {
+    std::size_t written = 0;
+    for(;;) {
+      const auto n = std::min(pending_size_, size - written);
+      if(n) std::memcpy(out + written, pending_, n);
+      pending_ += n;
+      pending_size_ -= n;
+      written += n;
+      if(written == size || stack_.empty()) return written;
+      stack_.back().step(*this);
+    }
+  }
+
+ private:
+  struct frame {
+    void (*step)(msgpack_encoder&);
+    const void* object;
+    std::size_t index;
+  };
+
+  msgpack_mode mode_;
+  std::vector<frame> stack_;
+  std::string scratch_;
+  const char* pending_ = nullptr;
+  std::size_t pending_size_ = 0;
+
+  template<class T>
+  void push(const T* t) { stack_.push_back({&step<T>, t, 0}); }
+
+  void emit(const char* data, std::size_t size) {
+    pending_ = data;
+    pending_size_ = size;
+  }
+  void emit_scratch() { emit(scratch_.data(), scratch_.size()); }
+
+// one step of the top frame: emit some bytes, push a child, or pop
+  template<class T>
+  static void step(msgpack_encoder& e) {
+    frame& f = e.stack_.back();
+    const T& t = *static_cast<const T*>(f.object);
+    e.scratch_.clear();
+
+    if constexpr(detail::is_msgpack_str_v<T> || detail::is_msgpack_bin_v<T>) {
+      if(f.index++ == 0) {
+        if constexpr(detail::is_msgpack_str_v<T>) {
+          detail::append_msgpack_str_header(e.scratch_, t.size());
+        }
+        else {
+          detail::append_msgpack_bin_header(e.scratch_, t.size());
+        }
+        e.emit_scratch();
+      }
+      else {
+        e.stack_.pop_back();
+        e.emit(reinterpret_cast<const char*>(t.data()), t.size());
+      }
+    }
+    else if constexpr(
+      detail::is_msgpack_array_v<T> && !detail::is_msgpack_bits_v<T>
+    ) {
+      using Element = typename T::value_type;
+      if(f.index == 0) {
+        ++f.index;
+        detail::append_msgpack_array_header(e.scratch_, t.size());
+        e.emit_scratch();
+      }
+      else if(f.index <= t.size()) {
+        const Element* element = &t[f.index++ - 1];
+        e.push<Element>(element);
+      }
+      else {
+        e.stack_.pop_back();
+      }
+    }
+    else if constexpr(is_annotated<T>{}) {
+      if(e.mode_ == msgpack_mode::map) step_map<T>(e, f, t);
+      else step_array<T>(e, f, t);
+    }
+    else {
+      e.stack_.pop_back();
+      msgpack_value<T>::encode(e.scratch_, t, e.mode_);
+      e.emit_scratch();
+    }
+  }
+
+  template<class Outer>
+  static void step_map(msgpack_encoder& e, frame& f, const Outer& outer) {
+    using Paths = detail::member_paths_t<Outer>;
+    constexpr std::size_t count = std::tuple_size_v<Paths>;
+    if(f.index == 0) {
+      if(!detail::msgpack_member_names<Outer>::unique) {
+        detail::msgpack_input::error(
+          "member names repeat across bases, use array mode"
+        );
+      }
+      ++f.index;
+      detail::append_msgpack_map_header(e.scratch_, count);
+      e.emit_scratch();
+    }
+    else if(f.index <= 2 * count) {
+      const std::size_t i = (f.index - 1) / 2;
+      const bool key = (f.index++ - 1) % 2 == 0;
+      map_entry_steps<Outer>(std::make_index_sequence<count>{})[i](
+        e, outer, key
+      );
+    }
+    else {
+      e.stack_.pop_back();
+    }
+  }
+
+  template<class Outer, class Path>
+  static void map_entry(msgpack_encoder& e, const Outer& outer, bool key) {
+    using Item = typename Path::last_item;
+    using Inner = std::decay_t<typename Item::inner_type>;
+    if(key) {
+      auto view = detail::msgpack_key<Item>::view();
+      e.emit(view.data(), view.size());
+    }
+    else {
+      e.push<Inner>(&Path::get(outer));
+    }
+  }
+
+  template<class Outer, std::size_t... is>
+  static constexpr auto map_entry_steps(std::index_sequence<is...>) {
+    using Paths = detail::member_paths_t<Outer>;
+    using fn = void (*)(msgpack_encoder&, const Outer&, bool);
+    return std::array<fn, sizeof...(is)>{
+      &map_entry<Outer, std::tuple_element_t<is, Paths>>...
+    };
+  }
+
+  template<class Outer>
+  static void step_array(msgpack_encoder& e, frame& f, const Outer& outer) {
+    constexpr std::size_t count = items<Outer>::count;
+    if(f.index == 0) {
+      ++f.index;
+      detail::append_msgpack_array_header(e.scratch_, count);
+      e.emit_scratch();
+    }
+    else if(f.index <= count) {
+      const std::size_t i = f.index++ - 1;
+      array_item_steps<Outer>(items<Outer>::ind_seq)[i](e, outer);
+    }
+    else {
+      e.stack_.pop_back();
+    }
+  }
+
+  template<class Outer, class Item>
+  static void array_item(msgpack_encoder& e, const Outer& outer) {
+    using Inner = std::decay_t<typename Item::inner_type>;
+    e.push<Inner>(&Item{}(outer));
+  }
+
+  template<class Outer, std::size_t... is>
+  static constexpr auto array_item_steps(std::index_sequence<is...>) {
+    using fn = void (*)(msgpack_encoder&, const Outer&);
+    return std::array<fn, sizeof...(is)>{
+      &array_item<Outer, item<is, Outer>>...
+    };
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Decodes one MessagePack value into `outer` from input fed in fragments of
+// any size, with the semantics of `decode_msgpack`:
+// ```
+// Order order;
+// ecrypa::msgpack_decoder decoder{order};
+// while(!decoder.done()) decoder.feed(receive());
+// ```
+// Types with user-provided `msgpack_value` specializations are buffered until
+// their whole value has arrived, then decoded by it. Throws `msgpack_error` on
+// malformed input, and on a map for a type whose bases repeat member names
+// (see `msgpack_mode`).
+class msgpack_decoder {
+ public:
+  template<class Outer>
+  explicit msgpack_decoder(Outer& outer) {
+    push_value<Outer>(&outer);
+  }
+
+  bool done() const { return stack_.empty(); }
+
+// consumes input up to the end of the value; returns the bytes consumed
+  std::size_t feed(std::string_view input) {
+    in_ = input.data();
+    in_end_ = input.data() + input.size();
+    while(!stack_.empty()) {
+      const char* const from = in_;
+      const bool more = stack_.back().step(*this);
+      if(capturing_) capture_.append(from, std::size_t(in_ - from));
+      if(!more) break;
+    }
+    return std::size_t(in_ - input.data());
+  }
+
+ private:
+// `step` returns false when it needs more input
+  struct frame {
+    bool (*step)(msgpack_decoder&);
+    void* object;
+    std::size_t remaining;
+    std::size_t index;
+  };
+
+  std::vector<frame> stack_;
+  const char* in_ = nullptr;
+  const char* in_end_ = nullptr;
+
+// head of the current value: type byte plus fixed-size length/value bytes
+  char head_[9];
+  std::size_t head_size_ = 0;
+  std::size_t head_need_ = 0;
+
+// key of the current map entry
+  std::string key_;
+
+// raw bytes of a value decoded by a user `msgpack_value`, collected while
+// `capturing_`
+  std::string capture_;
+  bool capturing_ = false;
+
+  [[noreturn]] static void error(const char* what) {
+    detail::msgpack_input::error(what);
+  }
+
+  template<class T>
+  void push_value(T* t) { stack_.push_back({&value_step<T>, t, 0, 0}); }
+
+  void push_skip() { stack_.push_back({&skip_step, nullptr, 0, 0}); }
+
+  static std::size_t head_size(unsigned char b) {
+    if(b < 0xc0 || b >= 0xe0) return 1;
+    switch(b) {
+      case 0xc0: case 0xc2: case 0xc3: return 1;
+      case 0xc4: case 0xcc: case 0xd0: case 0xd9: return 2;
+      case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8: return 2;
+      case 0xc5: case 0xcd: case 0xd1: case 0xda: case 0xdc: case 0xde:
+        return 3;
+      case 0xc7: return 3;
+      case 0xc8: return 4;
+      case 0xc6: case 0xca: case 0xce: case 0xd2: case 0xdb: case 0xdd:
+      case 0xdf:
+        return 5;
+      case 0xc9: return 6;
+      case 0xcb: case 0xcf: case 0xd3: return 9;
+      default: error("invalid type byte");
+    }
+  }
+
+// the complete head, or nullptr if more input is needed
+  const char* head() {
+    if(head_size_ == 0) {
+      if(in_ == in_end_) return nullptr;
+      head_[head_size_++] = *in_++;
+      head_need_ = head_size(static_cast<unsigned char>(head_[0]));
+    }
+    while(head_size_ < head_need_ && in_ != in_end_) {
+      head_[head_size_++] = *in_++;
+    }
+    return head_size_ == head_need_ ? head_ : nullptr;
+  }
+
+// the last complete head; stays valid after `head_size_` is reset for the
+// next one
+  detail::msgpack_input head_input() const {
+    return {head_, head_ + head_need_};
+  }
+
+// payload bytes following a str, bin or ext head (whose ext type byte is
+// part of the head)
+  std::size_t payload_size() const {
+    auto in = head_input();
+    auto b = static_cast<unsigned char>(*in.p++);
+    if((b & 0xe0) == 0xa0) return b & 0x1f;
+    switch(b) {
+      case 0xc4: case 0xd9: return in.big_endian(1);
+      case 0xc5: case 0xda: return in.big_endian(2);
+      case 0xc6: case 0xdb: return in.big_endian(4);
+      case 0xc7: return in.big_endian(1);
+      case 0xc8: return in.big_endian(2);
+      case 0xc9: return in.big_endian(4);
+      case 0xd4: return 1;
+      case 0xd5: return 2;
+      case 0xd6: return 4;
+      case 0xd7: return 8;
+      case 0xd8: return 16;
+      default: return 0;
+    }
+  }
+
+  bool head_is_str() const {
+    auto b = static_cast<unsigned char>(head_[0]);
+    return (b & 0xe0) == 0xa0 || b == 0xd9 || b == 0xda || b == 0xdb;
+  }
+
+  bool head_is_bin() const {
+    auto b = static_cast<unsigned char>(head_[0]);
+    return b == 0xc4 || b == 0xc5 || b == 0xc6;
+  }
+
+// copies up to `remaining` bytes of payload into a string or byte buffer at
+// offset `index`, growing it as they arrive (never ahead of the input, since
+// the length comes from the peer); drops them for `Bytes = void`
+  template<class Bytes>
+  static bool bytes_step(msgpack_decoder& d) {
+    frame& f = d.stack_.back();
+    const auto n = std::min(f.remaining, std::size_t(d.in_end_ - d.in_));
+    if constexpr(detail::is_msgpack_str_v<Bytes>) {
+      static_cast<Bytes*>(f.object)->append(d.in_, n);
+    }
+    else if constexpr(!std::is_void_v<Bytes>) {
+      auto& bytes = *static_cast<Bytes*>(f.object);
+      if constexpr(!detail::is_msgpack_fixed_v<Bytes>) {
+        bytes.resize(f.index + n);
+      }
+      if(n) std::memcpy(bytes.data() + f.index, d.in_, n);
+      f.index += n;
+    }
+    d.in_ += n;
+    f.remaining -= n;
+    if(f.remaining) return false;
+    d.stack_.pop_back();
+    return true;
+  }
+
+  template<class Bytes>
+  void become_bytes(Bytes* target, std::size_t n) {
+    stack_.back() = {&bytes_step<Bytes>, target, n, 0};
+  }
+
+// types decoded frame by frame; any other type is captured whole for its
+// `msgpack_value`
+  template<class T>
+  static constexpr bool is_streamed_v =
+    detail::is_msgpack_str_v<T> || detail::is_msgpack_bin_v<T>
+    || detail::is_msgpack_array_v<T> || is_annotated<T>{}
+    || std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+  template<class T>
+  static bool value_step(msgpack_decoder& d) {
+    if constexpr(!is_streamed_v<T>) {
+      d.capturing_ = true;
+      d.capture_.clear();
+      d.stack_.back().step = &captured_step<T>;
+      d.push_skip();
+      return true;
+    }
+    if(!d.head()) return false;
+    T& t = *static_cast<T*>(d.stack_.back().object);
+    d.head_size_ = 0;
+
+    if constexpr(detail::is_msgpack_str_v<T>) {
+      if(!d.head_is_str()) error("expected string");
+      t.clear();
+      d.become_bytes(&t, d.payload_size());
+    }
+    else if constexpr(detail::is_msgpack_bin_v<T>) {
+      if(!d.head_is_bin()) error("expected bin");
+      const auto n = d.payload_size();
+      if constexpr(!detail::is_msgpack_fixed_v<T>) {
+        t.clear();
+      }
+      else if(n != t.size()) {
+        error("bin size mismatch");
+      }
+      d.become_bytes(&t, n);
+    }
+    else if constexpr(detail::is_msgpack_array_v<T>) {
+      auto in = d.head_input();
+      const auto n = in.array_header();
+      if constexpr(!detail::is_msgpack_fixed_v<T>) {
+        t.clear();
+      }
+      else if(n != t.size()) {
+        error("array size mismatch");
+      }
+      d.stack_.back() = {&sequence_step<T>, &t, n, 0};
+    }
+    else if constexpr(is_annotated<T>{}) {
+      auto in = d.head_input();
+      if(in.is_map()) {
+        if(!detail::msgpack_member_names<T>::unique) {
+          error("member names repeat across bases, use array mode");
+        }
+        d.stack_.back() = {&map_step<T>, &t, in.map_header(), 0};
+      }
+      else {
+        d.stack_.back() = {&array_step<T>, &t, in.array_header(), 0};
+      }
+    }
+    else if constexpr(is_streamed_v<T>) {
+      auto in = d.head_input();
+      msgpack_value<T>::decode(in, t);
+      d.stack_.pop_back();
+    }
+    return true;
+  }
+
+// runs once the value's bytes have been skipped into `capture_`
+  template<class T>
+  static bool captured_step(msgpack_decoder& d) {
+    d.capturing_ = false;
+    detail::msgpack_input in{
+      d.capture_.data(), d.capture_.data() + d.capture_.size()
+    };
+    msgpack_value<T>::decode(in, *static_cast<T*>(d.stack_.back().object));
+    d.stack_.pop_back();
+    return true;
+  }
+
+// elements of a vector (appended) or std::array (by `index`)
+  template<class T>
+  static bool sequence_step(msgpack_decoder& d) {
+    frame& f = d.stack_.back();
+    if(f.remaining == 0) {
+      d.stack_.pop_back();
+      return true;
+    }
+    --f.remaining;
+    auto& seq = *static_cast<T*>(f.object);
+    using Element = typename T::value_type;
+    if constexpr(detail::is_msgpack_fixed_v<T>) {
+      d.push_value<Element>(&seq[f.index++]);
+    }
+    else if constexpr(detail::is_msgpack_bits_v<T>) {
+      d.stack_.push_back({&bit_step<T>, &seq, 0, 0});
+    }
+    else {
+      d.push_value<Element>(&seq.emplace_back());
+    }
+    return true;
+  }
+
+// appends one element to a `std::vector<bool>`
+  template<class T>
+  static bool bit_step(msgpack_decoder& d) {
+    if(!d.head()) return false;
+    d.head_size_ = 0;
+    auto in = d.head_input();
+    bool b = false;
+    msgpack_value<bool>::decode(in, b);
+    static_cast<T*>(d.stack_.back().object)->push_back(b);
+    d.stack_.pop_back();
+    return true;
+  }
+
+// map entries alternate between the key (read into `key_`) and the value;
+// `index` is odd once the key has been read
+  template<class Outer>
+  static bool map_step(msgpack_decoder& d) {
+    frame& f = d.stack_.back();
+    if(f.index++ % 2 == 0) {
+      if(f.remaining == 0) {
+        d.stack_.pop_back();
+      }
+      else {
+        --f.remaining;
+        d.stack_.push_back({&key_step, nullptr, 0, 0});
+      }
+      return true;
+    }
+    using Decoders = detail::msgpack_map_decoders<Outer>;
+    auto& outer = *static_cast<Outer*>(f.object);
+    if(const auto* slot = Decoders::find_slot(d.key_)) {
+      map_value_pushers<Outer>(
+        std::make_index_sequence<Decoders::count>{}
+      )[slot->index](d, outer);
+    }
+    else {
+      d.push_skip();
+    }
+    return true;
+  }
+
+  static bool key_step(msgpack_decoder& d) {
+    if(!d.head()) return false;
+    d.head_size_ = 0;
+    if(!d.head_is_str()) error("expected string key");
+    d.key_.clear();
+    d.become_bytes(&d.key_, d.payload_size());
+    return true;
+  }
+
+  template<class Outer, class Path>
+  static void push_path(msgpack_decoder& d, Outer& outer) {
+    using Target = decltype(Path::get(outer));
+    using Inner = std::remove_reference_t<Target>;
+    if constexpr(
+      std::is_lvalue_reference_v<Target> && !std::is_const_v<Inner>
+    ) {
+      d.push_value<std::decay_t<Inner>>(&Path::get(outer));
+    }
+    else {
+      d.push_skip();// not assignable
+    }
+  }
+
+  template<class Outer, std::size_t... is>
+  static constexpr auto map_value_pushers(std::index_sequence<is...>) {
+    using Paths = detail::member_paths_t<Outer>;
+    using fn = void (*)(msgpack_decoder&, Outer&);
+    return std::array<fn, sizeof...(is)>{
+      &push_path<Outer, std::tuple_element_t<is, Paths>>...
+    };
+  }
+
+  template<class Outer>
+  static bool array_step(msgpack_decoder& d) {
+    frame& f = d.stack_.back();
+    if(f.remaining == 0) {
+      d.stack_.pop_back();
+      return true;
+    }
+    --f.remaining;
+    const std::size_t i = f.index++;
+    auto& outer = *static_cast<Outer*>(f.object);
+    if(i < items<Outer>::count) {
+      array_item_pushers<Outer>(items<Outer>::ind_seq)[i](d, outer);
+    }
+    else {
+      d.push_skip();
+    }
+    return true;
+  }
+
+  template<class Outer, std::size_t... is>
+  static constexpr auto array_item_pushers(std::index_sequence<is...>) {
+    using fn = void (*)(msgpack_decoder&, Outer&);
+    return std::array<fn, sizeof...(is)>{
+      &push_path<Outer, detail::item_path<item<is, Outer>>>...
+    };
+  }
+
+// skips one value of any type; containers count their remaining elements
+  static bool skip_step(msgpack_decoder& d) {
+    frame& f = d.stack_.back();
+    if(f.index) {
+      if(f.remaining == 0) {
+        d.stack_.pop_back();
+      }
+      else {
+        --f.remaining;
+        d.push_skip();
+      }
+      return true;
+    }
+    if(!d.head()) return false;
+    d.head_size_ = 0;
+    auto in = d.head_input();
+    auto b = static_cast<unsigned char>(d.head_[0]);
+    if((b & 0xf0) == 0x80 || b == 0xde || b == 0xdf) {
+      f = {&skip_step, nullptr, 2 * in.map_header(), 1};
+    }
+    else if((b & 0xf0) == 0x90 || b == 0xdc || b == 0xdd) {
+      f = {&skip_step, nullptr, in.array_header(), 1};
+    }
+    else if(auto n = d.payload_size()) {
+      d.become_bytes<void>(nullptr, n);
+    }
+    else {
+      d.stack_.pop_back();
+    }
+    return true;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <type_traits>
+#include <utility>
+
+#include <ecrypa/v0/items.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Enums whose values fit in a few bits opt into bit packing by `packed` with
+// an ADL hook next to the enum (values must fit in the given number of bits):
+// ```
+// enum class Side : unsigned char { buy, sell };
+// constexpr unsigned packed_bits(Side*) { return 1; }
+// ```
+template<class E, class ExpressionSfinae = void>
+struct has_packed_bits : std::false_type {};
+
+template<class E>
+struct has_packed_bits<
+  E, std::void_t<decltype(packed_bits(static_cast<E*>(nullptr)))>
+> : std::true_type {};
+
+// bits of a member in `packed`, or 0 if it is stored whole
+template<class T>
+constexpr unsigned packed_bit_width() {
+  if constexpr(std::is_same_v<T, bool>) {
+    return 1;
+  }
+  else if constexpr(std::is_enum_v<T> && has_packed_bits<T>{}) {
+    constexpr unsigned bits = packed_bits(static_cast<T*>(nullptr));
+    static_assert(bits > 0 && bits <= 8 * sizeof(T), "packed_bits: range");
+    return bits;
+  }
+  else {
+    return 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Fields laid out in the order given (unlike `std::tuple`, whose layout is
+// unspecified).
+template<class... Ts>
+struct packed_fields {};
+
+template<class T>
+struct packed_fields<T> {
+  T first{};
+};
+
+template<class T, class U, class... Rest>
+struct packed_fields<T, U, Rest...> {
+  T first{};
+  packed_fields<U, Rest...> rest{};
+};
+
+template<std::size_t j, class Fields>
+constexpr auto& packed_field(Fields& fields) {
+  if constexpr(j == 0) return fields.first;
+  else return packed_field<j - 1>(fields.rest);
+}
+
+template<class Outer, std::size_t idx>
+using packed_member_t = std::decay_t<typename item<idx, Outer>::inner_type>;
+
+template<class Outer>
+struct packed_layout {
+  static constexpr std::size_t count = items<Outer>::count;
+
+  template<std::size_t... is>
+  static constexpr std::array<unsigned, count> make_widths(
+    std::index_sequence<is...>
+  ) {
+    return {packed_bit_width<packed_member_t<Outer, is>>()...};
+  }
+  static constexpr auto widths = make_widths(items<Outer>::ind_seq);
+
+  static constexpr unsigned total_bits() {
+    unsigned ret = 0;
+    for(unsigned w : widths) ret += w;
+    return ret;
+  }
+
+  using word_type = std::conditional_t<
+    total_bits() <= 8, std::uint8_t, std::conditional_t<
+    total_bits() <= 16, std::uint16_t, std::conditional_t<
+    total_bits() <= 32, std::uint32_t, std::uint64_t
+  >>>;
+  static constexpr unsigned word_bits = 8 * sizeof(word_type);
+
+// word and shift of each bit-packed item; no item straddles two words
+  struct bit_position {
+    std::size_t word = 0;
+    unsigned shift = 0;
+  };
+  static constexpr std::array<bit_position, count> make_bit_positions() {
+    std::array<bit_position, count> ret{};
+    std::size_t word = 0;
+    unsigned shift = 0;
+    for(std::size_t i=0; i<count; ++i) {
+      if(!widths[i]) continue;
+      if(shift + widths[i] > word_bits) {
+        ++word;
+        shift = 0;
+      }
+      ret[i] = {word, shift};
+      shift += widths[i];
+    }
+    return ret;
+  }
+  static constexpr auto bit_positions = make_bit_positions();
+
+  static constexpr std::size_t word_count() {
+    std::size_t ret = 0;
+    for(std::size_t i=0; i<count; ++i) {
+      if(widths[i]) ret = bit_positions[i].word + 1;
+    }
+    return ret;
+  }
+  using words_type = std::array<word_type, word_count()>;
+
+// fields: the whole members and, as index `count`, the bit words, by
+// decreasing alignment so that only tail padding remains
+  static constexpr std::size_t make_field_count() {
+    std::size_t n = word_count() != 0;
+    for(unsigned w : widths) n += w == 0;
+    return n;
+  }
+  static constexpr std::size_t field_count = make_field_count();
+
+  template<std::size_t... is>
+  static constexpr std::array<std::size_t, count + 1> make_aligns(
+    std::index_sequence<is...>
+  ) {
+    return {alignof(packed_member_t<Outer, is>)..., alignof(words_type)};
+  }
+  static constexpr auto aligns = make_aligns(items<Outer>::ind_seq);
+
+  static constexpr std::array<std::size_t, field_count> make_fields() {
+    std::array<std::size_t, field_count> ret{};
+    std::size_t max_align = 1;
+    for(std::size_t a : aligns) max_align = a > max_align ? a : max_align;
+    std::size_t n = 0;
+    for(std::size_t align = max_align; align; align /= 2) {
+      for(std::size_t i=0; i<=count; ++i) {
+        const bool whole = i < count ? widths[i] == 0 : word_count() != 0;
+        if(whole && aligns[i] == align) ret[n++] = i;
+      }
+    }
+    return ret;
+  }
+  static constexpr auto fields = make_fields();
+
+  static constexpr std::size_t field_of(std::size_t i) {
+    std::size_t j = 0;
+    while(fields[j] != i) ++j;
+    return j;
+  }
+
+  template<std::size_t i, class ExpressionSfinae = void>
+  struct field_type {
+    using type = packed_member_t<Outer, i>;
+  };
+  template<class ExpressionSfinae>
+  struct field_type<count, ExpressionSfinae> {
+    using type = words_type;
+  };
+
+  template<std::size_t... js>
+  static auto make_storage(std::index_sequence<js...>)
+    -> packed_fields<typename field_type<fields[js]>::type...>;
+
+  using storage_type = decltype(make_storage(
+    std::make_index_sequence<field_count>{}
+  ));
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The members of `Outer` reordered by decreasing alignment, with `bool`s and
+// enums with `packed_bits` in shared bit words, for large resident arrays:
+// ```
+// constexpr ecrypa::packed<Order> p{order};
+// Side side = p.get(ecrypa::item<3, Order>{});
+// q.set(ecrypa::item<3, Order>{}, Side::sell);
+// ```
+// Members are accessed by item handle; `get` returns whole members by
+// reference and bit-packed ones by value.
+template<class Outer>
+class packed {
+  using layout = detail::packed_layout<Outer>;
+
+  static_assert(
+    items<Outer>::apply([] (auto... bms) {
+      return (... && (
+        bms.is_member
+        && !std::is_reference_v<typename decltype(bms)::inner_type>
+      ));
+    }),
+    "packed: all items must be nonreference members"
+  );
+
+ public:
+  constexpr packed() = default;
+
+  constexpr explicit packed(const Outer& outer) {
+    each_item<Outer>([&] (auto bm) { set(bm, bm(outer)); });
+  }
+
+  constexpr Outer to_outer() const {
+    Outer ret{};
+    each_item<Outer>([&] (auto bm) { bm(ret) = get(bm); });
+    return ret;
+  }
+
+  template<class Item>
+  constexpr decltype(auto) get(Item) const {
+    static_assert(std::is_same_v<typename Item::outer_type, Outer>);
+    constexpr std::size_t i = Item::idx;
+    using Inner = detail::packed_member_t<Outer, i>;
+    constexpr unsigned width = layout::widths[i];
+    if constexpr(width != 0) {
+      constexpr auto pos = layout::bit_positions[i];
+      const auto& words = words_storage();
+      auto bits = std::uint64_t(words[pos.word] >> pos.shift);
+      bits &= mask(width);
+      if constexpr(std::is_same_v<Inner, bool>) {
+        return bool(bits);
+      }
+      else {
+        using U = std::underlying_type_t<Inner>;
+        if constexpr(std::is_signed_v<U>) {// sign-extend
+          if(width < 64 && (bits >> (width - 1)) & 1) bits |= ~mask(width);
+        }
+        return static_cast<Inner>(static_cast<U>(bits));
+      }
+    }
+    else {
+      return static_cast<const Inner&>(
+        detail::packed_field<layout::field_of(i)>(storage_)
+      );
+    }
+  }
+
+  template<class Item>
+  constexpr decltype(auto) get(Item item) {
+    constexpr std::size_t i = Item::idx;
+    if constexpr(layout::widths[i] != 0) {
+      return std::as_const(*this).get(item);
+    }
+    else {
+      return detail::packed_field<layout::field_of(i)>(storage_);
+    }
+  }
+
+  template<class Item, class Value>
+  constexpr void set(Item, const Value& value) {
+    static_assert(std::is_same_v<typename Item::outer_type, Outer>);
+    constexpr std::size_t i = Item::idx;
+    using Inner = detail::packed_member_t<Outer, i>;
+    constexpr unsigned width = layout::widths[i];
+    if constexpr(width != 0) {
+      using Word = typename layout::word_type;
+      constexpr auto pos = layout::bit_positions[i];
+      std::uint64_t bits = 0;
+      if constexpr(std::is_same_v<Inner, bool>) {
+        bits = bool(value);
+      }
+      else {
+        using U = std::underlying_type_t<Inner>;
+        bits = std::uint64_t(static_cast<U>(static_cast<Inner>(value)));
+      }
+      auto& word = words_storage()[pos.word];
+      const std::uint64_t m = mask(width) << pos.shift;
+      word = Word((std::uint64_t(word) & ~m) | ((bits << pos.shift) & m));
+    }
+    else {
+      detail::packed_field<layout::field_of(i)>(storage_) = value;
+    }
+  }
+
+ private:
+  typename layout::storage_type storage_{};
+
+  static constexpr std::uint64_t mask(unsigned width) {
+    return width == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << width) - 1;
+  }
+
+  constexpr auto& words_storage() {
+    return detail::packed_field<layout::field_of(layout::count)>(storage_);
+  }
+  constexpr const auto& words_storage() const {
+    return detail::packed_field<layout::field_of(layout::count)>(storage_);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
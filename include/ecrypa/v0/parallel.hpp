@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cstddef>
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A fixed set of worker threads running submitted tasks in FIFO order.
+// Threads waiting for tasks (see `each_member_par`) run queued tasks
+// themselves, so that nested waits cannot starve the pool.
+class task_pool {
+ public:
+  explicit task_pool(
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency())
+  ) {
+    for(std::size_t i=0; i<threads; ++i) {
+      workers_.emplace_back([this] { work(); });
+    }
+  }
+
+  task_pool(const task_pool&) = delete;
+  task_pool& operator=(const task_pool&) = delete;
+
+// runs the queued tasks, then joins the workers
+  ~task_pool() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stop_ = true;
+    }
+    ready_.notify_all();
+    for(std::thread& t : workers_) t.join();
+  }
+
+  static task_pool& global() {
+    static task_pool ret;
+    return ret;
+  }
+
+  std::size_t size() const { return workers_.size(); }
+
+  void submit(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      tasks_.push_back(std::move(task));
+    }
+    ready_.notify_one();
+  }
+
+// runs one queued task on the calling thread; false if none was queued
+  bool try_run_one() {
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if(tasks_.empty()) return false;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::function<void()>> tasks_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+
+  void work() {
+    for(;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        ready_.wait(lock, [&] { return stop_ || !tasks_.empty(); });
+        if(tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class T, class ExpressionSfinae = void>
+struct has_size_member : std::false_type {};
+
+template<class T>
+struct has_size_member<
+  T,
+  std::void_t<decltype(std::declval<const T&>().size()), typename T::value_type>
+> : std::true_type {};
+
+// rough bytes to process: elements times their size for containers
+template<class T>
+std::size_t member_cost(const T& t) {
+  if constexpr(has_size_member<T>{}) {
+    return sizeof(T) + t.size() * sizeof(typename T::value_type);
+  }
+  else {
+    return sizeof(T);
+  }
+}
+
+// counts finished tasks and keeps the first exception
+class task_latch {
+ public:
+  void add() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++pending_;
+  }
+
+  void done(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if(error && !error_) error_ = std::move(error);
+    if(--pending_ == 0) finished_.notify_all();
+  }
+
+// helps `pool` until all tasks are done, then rethrows the first exception
+  void wait(task_pool& pool) {
+    for(;;) {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if(pending_ == 0) break;
+      }
+      if(pool.try_run_one()) continue;
+      std::unique_lock<std::mutex> lock{mutex_};
+      finished_.wait(lock, [&] { return pending_ == 0; });
+    }
+    if(error_) std::rethrow_exception(error_);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable finished_;
+  std::size_t pending_ = 0;
+  std::exception_ptr error_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Like `each_member<Outer>(f)`, but members of `outer` that cost at least
+// `threshold` bytes (containers count their elements) run on `pool` while
+// the others run inline; returns once all have run, rethrowing the first
+// exception. `f` receives the member handle, as with `each_member`, and
+// must be safe to call concurrently for different members:
+// ```
+// std::array<std::string, ecrypa::members<Snapshot>::count> parts;
+// ecrypa::each_member_par(snapshot, [&] (auto m) {
+//   auto& part = parts[m.idx - ecrypa::bases<Snapshot>::count];
+//   ecrypa::encode_msgpack(part, m(snapshot));
+// });
+// ```
+template<class Outer, class F>
+void each_member_par(
+  const Outer& outer,
+  F&& f,
+  std::size_t threshold = std::size_t{1} << 20,
+  task_pool& pool = task_pool::global()
+) {
+  std::array<bool, members<Outer>::count> heavy{};
+  std::size_t i = 0;
+  each_member<Outer>([&] (auto m) {
+    heavy[i++] = detail::member_cost(m(outer)) >= threshold;
+  });
+
+  // queued tasks refer to `latch` and `f`: wait for them on every path
+  detail::task_latch latch;
+  std::exception_ptr error;
+  try {
+    i = 0;
+    each_member<Outer>([&] (auto m) {
+      if(!heavy[i++]) return;
+      latch.add();
+      try {
+        pool.submit([&latch, &f, m] {
+          try {
+            f(m);
+            latch.done(nullptr);
+          }
+          catch(...) {
+            latch.done(std::current_exception());
+          }
+        });
+      }
+      catch(...) {
+        latch.done(nullptr);// not queued
+        throw;
+      }
+    });
+
+    i = 0;
+    each_member<Outer>([&] (auto m) {
+      if(!heavy[i++]) f(m);
+    });
+  }
+  catch(...) {
+    error = std::current_exception();
+  }
+  latch.wait(pool);
+  if(error) std::rethrow_exception(error);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
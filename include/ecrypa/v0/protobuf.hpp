@@ -0,0 +1,557 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/traits.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+class protobuf_error : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// Field numbers default to item index + 1. To choose them, provide a constexpr
+// ADL function returning one number per item:
+// ```
+// struct Quote {
+//   std::string symbol;
+//   double price;
+//
+//   friend constexpr auto protobuf_field_numbers(Quote*) {
+//     return std::array<std::uint32_t, 2>{1, 4};
+//   }
+//   template<class A> friend constexpr auto annotate(A a, Quote*) { ... }
+// };
+// ```
+template<class Outer, class ExpressionSfinae = void>
+struct has_protobuf_field_numbers : std::false_type {};
+
+template<class Outer>
+struct has_protobuf_field_numbers<
+  Outer,
+  std::void_t<decltype(protobuf_field_numbers(static_cast<Outer*>(nullptr)))>
+> : std::true_type {};
+
+template<class Outer>
+constexpr std::uint32_t protobuf_field_number(std::size_t idx) {
+  if constexpr(has_protobuf_field_numbers<Outer>{}) {
+    constexpr auto numbers =
+      protobuf_field_numbers(static_cast<Outer*>(nullptr));
+    static_assert(numbers.size() == items<Outer>::count);
+    return numbers[idx];
+  }
+  else {
+    return std::uint32_t(idx + 1);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum protobuf_wire_type : int {
+  protobuf_varint = 0,
+  protobuf_fixed64 = 1,
+  protobuf_length_delimited = 2,
+  protobuf_fixed32 = 5
+};
+
+constexpr std::size_t varint_size(std::uint64_t v) {
+  std::size_t n = 1;
+  for(; v >= 0x80; v >>= 7) ++n;
+  return n;
+}
+
+inline std::size_t write_varint(char* out, std::uint64_t v) {
+  std::size_t n = 0;
+  for(; v >= 0x80; v >>= 7) out[n++] = char(v | 0x80);
+  out[n++] = char(v);
+  return n;
+}
+
+inline void append_varint(std::string& out, std::uint64_t v) {
+  char buf[10];
+  out.append(buf, write_varint(buf, v));
+}
+
+template<class T>
+void append_fixed(std::string& out, T t) {
+  char buf[sizeof(T)];
+  std::memcpy(buf, &t, sizeof(T));// protobuf is little-endian, as are we
+  out.append(buf, sizeof(T));
+}
+
+// encoded key of a field: `(number << 3) | wire_type` as varint
+template<std::uint32_t number, int wire_type>
+struct protobuf_key {
+  static constexpr std::uint64_t value =
+    (std::uint64_t{number} << 3) | std::uint64_t(wire_type);
+  static constexpr std::size_t size = varint_size(value);
+
+  static constexpr std::array<char, size> make_bytes() {
+    std::array<char, size> ret{};
+    std::uint64_t v = value;
+    for(std::size_t i=0; i<size; ++i, v >>= 7) {
+      ret[i] = char((v & 0x7f) | (i + 1 < size ? 0x80 : 0));
+    }
+    return ret;
+  }
+  static constexpr std::array<char, size> bytes = make_bytes();
+
+  static constexpr std::string_view view() { return {bytes.data(), size}; }
+};
+
+struct protobuf_input {
+  const char* p;
+  const char* end;
+
+  [[noreturn]] static void error(const char* what) {
+    throw protobuf_error(std::string("protobuf: ") + what);
+  }
+
+  bool empty() const { return p == end; }
+
+  std::uint64_t varint() {
+    std::uint64_t v = 0;
+    for(int shift=0; shift<64; shift+=7) {
+      if(p == end) error("truncated varint");
+      auto byte = static_cast<unsigned char>(*p++);
+      v |= std::uint64_t(byte & 0x7f) << shift;
+      if(!(byte & 0x80)) return v;
+    }
+    error("varint too long");
+  }
+
+  template<class T>
+  T fixed() {
+    if(std::size_t(end - p) < sizeof(T)) error("truncated fixed field");
+    T t;
+    std::memcpy(&t, p, sizeof(T));
+    p += sizeof(T);
+    return t;
+  }
+
+  protobuf_input length_delimited() {
+    auto n = varint();
+    if(n > std::uint64_t(end - p)) error("truncated length-delimited field");
+    protobuf_input ret{p, p + n};
+    p += n;
+    return ret;
+  }
+
+  void skip(int wire_type) {
+    switch(wire_type) {
+      case protobuf_varint: varint(); return;
+      case protobuf_fixed64: fixed<std::uint64_t>(); return;
+      case protobuf_length_delimited: length_delimited(); return;
+      case protobuf_fixed32: fixed<std::uint32_t>(); return;
+      default: error("unsupported wire type");
+    }
+  }
+
+  static void expect(int wire_type, int expected) {
+    if(wire_type != expected) error("unexpected wire type");
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// `protobuf_field<T>` maps `T` to the wire format:
+//   `wire_type`                  of the field key
+//   `encode(out, key, t)`        appends the field(s), key(s) included;
+//                                scalars equal to their default are omitted
+//   `decode(in, wire_type, t)`   merges one field occurrence into `t`
+// Specialize for more types.
+template<class T, class ExpressionSfinae = void>
+struct protobuf_field;
+
+// bool, integers and enums as (non-zigzag) varints
+template<class T>
+struct protobuf_field<
+  T,
+  std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>>
+> {
+  static constexpr int wire_type = detail::protobuf_varint;
+
+  static std::uint64_t bits(T t) {
+    if constexpr(std::is_enum_v<T>) {
+      return std::uint64_t(std::int64_t(std::underlying_type_t<T>(t)));
+    }
+    else if constexpr(std::is_signed_v<T>) {
+      return std::uint64_t(std::int64_t(t));
+    }
+    else {
+      return std::uint64_t(t);
+    }
+  }
+
+  static void encode(std::string& out, std::string_view key, T t) {
+    if(t == T{}) return;
+    out.append(key);
+    detail::append_varint(out, bits(t));
+  }
+  static void encode_packed(std::string& out, T t) {
+    detail::append_varint(out, bits(t));
+  }
+  static void decode(detail::protobuf_input& in, int wire_type, T& t) {
+    in.expect(wire_type, detail::protobuf_varint);
+    t = static_cast<T>(in.varint());
+  }
+};
+
+template<class T>
+struct protobuf_field<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8);
+  static constexpr int wire_type =
+    sizeof(T) == 4 ? detail::protobuf_fixed32 : detail::protobuf_fixed64;
+
+  static void encode(std::string& out, std::string_view key, T t) {
+    if(t == T{} && !std::signbit(t)) return;
+    out.append(key);
+    detail::append_fixed(out, t);
+  }
+  static void encode_packed(std::string& out, T t) {
+    detail::append_fixed(out, t);
+  }
+  static void decode(detail::protobuf_input& in, int wire_type, T& t) {
+    in.expect(wire_type, protobuf_field::wire_type);
+    t = in.fixed<T>();
+  }
+};
+
+template<class Traits, class Allocator>
+struct protobuf_field<std::basic_string<char, Traits, Allocator>> {
+  using T = std::basic_string<char, Traits, Allocator>;
+  static constexpr int wire_type = detail::protobuf_length_delimited;
+
+  static void encode(std::string& out, std::string_view key, const T& t) {
+    if(!t.empty()) encode_element(out, key, t);
+  }
+  static void encode_element(
+    std::string& out, std::string_view key, const T& t
+  ) {
+    out.append(key);
+    detail::append_varint(out, t.size());
+    out.append(t.data(), t.size());
+  }
+  static void decode(detail::protobuf_input& in, int wire_type, T& t) {
+    in.expect(wire_type, detail::protobuf_length_delimited);
+    auto s = in.length_delimited();
+    t.assign(s.p, s.end);
+  }
+};
+
+// repeated fields: packed for scalars, one field per element otherwise (via
+// `encode_element`, which does not omit defaults)
+template<class T, class Allocator>
+struct protobuf_field<std::vector<T, Allocator>> {
+  using Element = protobuf_field<T>;
+  static constexpr bool packed =
+    std::is_arithmetic_v<T> || std::is_enum_v<T>;
+  static constexpr int wire_type =
+    packed ? detail::protobuf_length_delimited : Element::wire_type;
+
+  static void encode(
+    std::string& out, std::string_view key, const std::vector<T, Allocator>& v
+  ) {
+    if(v.empty()) return;
+    if constexpr(packed) {
+      out.append(key);
+      if constexpr(Element::wire_type == detail::protobuf_varint) {
+        std::size_t n = 0;
+        for(const T& t : v) n += detail::varint_size(Element::bits(t));
+        detail::append_varint(out, n);
+        for(const T& t : v) Element::encode_packed(out, t);
+      }
+      else {
+        detail::append_varint(out, v.size() * sizeof(T));
+        auto at = out.size();
+        out.resize(at + v.size() * sizeof(T));
+        std::memcpy(&out[at], v.data(), v.size() * sizeof(T));
+      }
+    }
+    else {
+      for(const T& t : v) Element::encode_element(out, key, t);
+    }
+  }
+
+  static void decode(
+    detail::protobuf_input& in, int wire_type, std::vector<T, Allocator>& v
+  ) {
+    if(packed && wire_type == detail::protobuf_length_delimited) {
+      auto s = in.length_delimited();
+      if constexpr(packed && Element::wire_type != detail::protobuf_varint) {
+        const auto n = std::size_t(s.end - s.p);
+        if(n % sizeof(T)) in.error("truncated packed field");
+        const auto at = v.size();
+        v.resize(at + n / sizeof(T));
+        std::memcpy(v.data() + at, s.p, n);
+      }
+      else {
+        while(!s.empty()) decode_back(s, Element::wire_type, v);
+      }
+    }
+    else {
+      decode_back(in, wire_type, v);
+    }
+  }
+
+ private:
+  static void decode_back(
+    detail::protobuf_input& in, int wire_type, std::vector<T, Allocator>& v
+  ) {
+    if constexpr(std::is_same_v<T, bool>) {// no references to elements
+      bool b = false;
+      Element::decode(in, wire_type, b);
+      v.push_back(b);
+    }
+    else {
+      Element::decode(in, wire_type, v.emplace_back());
+    }
+  }
+};
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class Outer>
+void encode_protobuf_message(std::string& out, const Outer& outer);
+
+template<class Outer>
+void decode_protobuf_message(protobuf_input& in, Outer& outer);
+
+template<class Outer, class Item>
+constexpr std::string_view protobuf_item_key() {
+  using Inner = std::decay_t<typename Item::inner_type>;
+  return protobuf_key<
+    protobuf_field_number<Outer>(Item::idx),
+    protobuf_field<Inner>::wire_type
+  >::view();
+}
+
+template<class Outer>
+using protobuf_decode_fn = void (*)(protobuf_input&, int, Outer&);
+
+template<class Outer, class Item>
+void decode_protobuf_item(protobuf_input& in, int wire_type, Outer& outer) {
+  using Target = decltype(Item{}(outer));
+  using Inner = std::remove_reference_t<Target>;
+  if constexpr(std::is_lvalue_reference_v<Target> && !std::is_const_v<Inner>) {
+    protobuf_field<std::decay_t<Inner>>::decode(in, wire_type, Item{}(outer));
+  }
+  else {
+    in.skip(wire_type);// not assignable
+  }
+}
+
+template<class Outer>
+constexpr std::uint32_t max_protobuf_field_number() {
+  std::uint32_t ret = 0;
+  for(std::size_t i=0; i<items<Outer>::count; ++i) {
+    auto number = protobuf_field_number<Outer>(i);
+    if(number > ret) ret = number;
+  }
+  return ret;
+}
+
+template<class Outer>
+constexpr bool valid_protobuf_field_numbers() {
+  constexpr std::size_t n = items<Outer>::count;
+  for(std::size_t i=0; i<n; ++i) {
+    auto number = protobuf_field_number<Outer>(i);
+    if(number == 0 || number >= (std::uint32_t(1) << 29)) return false;
+    if(number >= 19000 && number <= 19999) return false;// reserved
+    for(std::size_t j=0; j<i; ++j) {
+      if(protobuf_field_number<Outer>(j) == number) return false;
+    }
+  }
+  return true;
+}
+
+// Decoder dispatch by field number: a jump table indexed by number when the
+// numbers are small, a table of `(number, decoder)` pairs otherwise.
+template<class Outer>
+struct protobuf_decoders {
+  static_assert(
+    valid_protobuf_field_numbers<Outer>(),
+    "protobuf: field numbers must be unique, in [1, 2^29) and not reserved"
+  );
+
+  static constexpr std::uint32_t max = max_protobuf_field_number<Outer>();
+  static constexpr bool dense = max <= 4 * items<Outer>::count + 16;
+
+  static constexpr auto make_table() {
+    std::array<protobuf_decode_fn<Outer>, dense ? max + 1 : 1> ret{};
+    each_item<Outer>([&] (auto bm) {
+      using Item = decltype(bm);
+      if constexpr(dense) {
+        ret[protobuf_field_number<Outer>(Item::idx)] =
+          &decode_protobuf_item<Outer, Item>;
+      }
+    });
+    return ret;
+  }
+  static constexpr auto table = make_table();
+
+  static constexpr auto make_numbers() {
+    std::array<std::uint32_t, items<Outer>::count> ret{};
+    for(std::size_t i=0; i<ret.size(); ++i) {
+      ret[i] = protobuf_field_number<Outer>(i);
+    }
+    return ret;
+  }
+  static constexpr auto numbers = make_numbers();
+
+  static constexpr auto make_sparse() {
+    std::array<protobuf_decode_fn<Outer>, items<Outer>::count> ret{};
+    each_item<Outer>([&] (auto bm) {
+      using Item = decltype(bm);
+      ret[Item::idx] = &decode_protobuf_item<Outer, Item>;
+    });
+    return ret;
+  }
+  static constexpr auto sparse = make_sparse();
+
+  static protobuf_decode_fn<Outer> find(std::uint64_t number) {
+    if constexpr(dense) {
+      return number <= max ? table[number] : nullptr;
+    }
+    else {
+      for(std::size_t i=0; i<numbers.size(); ++i) {
+        if(numbers[i] == number) return sparse[i];
+      }
+      return nullptr;
+    }
+  }
+};
+
+template<class Outer>
+void encode_protobuf_message(std::string& out, const Outer& outer) {
+  each_item<Outer>([&] (auto bm) {
+    using Item = decltype(bm);
+    using Inner = std::decay_t<typename Item::inner_type>;
+    protobuf_field<Inner>::encode(
+      out, protobuf_item_key<Outer, Item>(), bm(outer)
+    );
+  });
+}
+
+template<class Outer>
+void decode_protobuf_message(protobuf_input& in, Outer& outer) {
+  while(!in.empty()) {
+    auto key = in.varint();
+    auto decode = protobuf_decoders<Outer>::find(key >> 3);
+    if(decode) decode(in, int(key & 7), outer);
+    else in.skip(int(key & 7));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// annotated types as embedded messages
+template<class T>
+struct protobuf_field<T, std::enable_if_t<is_annotated<T>{}>> {
+  static constexpr int wire_type = detail::protobuf_length_delimited;
+
+  static void encode(std::string& out, std::string_view key, const T& t) {
+    encode_element(out, key, t);
+  }
+  static void encode_element(
+    std::string& out, std::string_view key, const T& t
+  ) {
+    // one byte for the length, widened afterwards if needed
+    out.append(key);
+    const auto at = out.size();
+    out.push_back(0);
+    detail::encode_protobuf_message(out, t);
+    const auto n = out.size() - at - 1;
+    if(n < 0x80) {
+      out[at] = char(n);
+    }
+    else {
+      char buf[10];
+      out.replace(at, 1, buf, detail::write_varint(buf, n));
+    }
+  }
+  static void decode(detail::protobuf_input& in, int wire_type, T& t) {
+    in.expect(wire_type, detail::protobuf_length_delimited);
+    auto s = in.length_delimited();
+    detail::decode_protobuf_message(s, t);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Appends `outer` as a protobuf message. Every item is a field: members by
+// their type, bases as embedded messages.
+template<class Outer>
+void encode_protobuf(std::string& out, const Outer& outer) {
+  detail::encode_protobuf_message(out, outer);
+}
+
+template<class Outer>
+std::string to_protobuf(const Outer& outer) {
+  std::string ret;
+  encode_protobuf(ret, outer);
+  return ret;
+}
+
+// Merges a protobuf message into `outer`, as protobuf parsers do: scalars
+// are overwritten, repeated fields appended, unknown fields skipped. Throws
+// `protobuf_error` on malformed input.
+template<class Outer>
+void decode_protobuf(std::string_view message, Outer& outer) {
+  detail::protobuf_input in{message.data(), message.data() + message.size()};
+  detail::decode_protobuf_message(in, outer);
+}
+
+template<class Outer>
+Outer from_protobuf(std::string_view message) {
+  Outer ret{};
+  decode_protobuf(message, ret);
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/traits.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Trivially relocatable types may be moved to new storage by copying their
+// bytes, with the old storage then considered dead (no destructor call).
+// This holds for trivially copyable types, for the library types listed
+// below, and for annotated types whose items all are and cover all of their
+// bytes (so no reference items, unannotated members or padding); specialize
+// for other types. Annotated types whose special members depend on the
+// object's address must be specialized to `false`.
+template<class T, class ExpressionSfinae = void>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template<class T>
+constexpr bool is_trivially_relocatable_v =
+  is_trivially_relocatable<T>::value;
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// bytes of an item within its outer object; empty bases take none
+template<class Inner>
+constexpr std::size_t relocation_footprint() {
+  return std::is_empty_v<Inner> ? 0 : sizeof(Inner);
+}
+
+// References may point into the object itself, and bytes not covered by
+// items may belong to unannotated members.
+template<class Outer, std::size_t... is>
+constexpr bool items_trivially_relocatable(std::index_sequence<is...>) {
+  return (true && ... && (
+    !std::is_reference_v<typename item<is, Outer>::inner_type>
+    && is_trivially_relocatable_v<typename item<is, Outer>::inner_type>
+  )) && (std::size_t{0} + ... + relocation_footprint<
+    typename item<is, Outer>::inner_type
+  >()) == sizeof(Outer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class T>
+struct is_trivially_relocatable<
+  T,
+  std::enable_if_t<is_annotated<T>{} && !std::is_trivially_copyable_v<T>>
+> : std::bool_constant<
+  detail::items_trivially_relocatable<T>(items<T>::ind_seq)
+> {};
+
+template<class T, class Deleter>
+struct is_trivially_relocatable<std::unique_ptr<T, Deleter>>
+  : is_trivially_relocatable<Deleter> {};
+
+template<class T>
+struct is_trivially_relocatable<std::shared_ptr<T>> : std::true_type {};
+
+template<class T>
+struct is_trivially_relocatable<std::optional<T>>
+  : is_trivially_relocatable<T> {};
+
+template<class T, std::size_t N>
+struct is_trivially_relocatable<std::array<T, N>>
+  : is_trivially_relocatable<T> {};
+
+template<class First, class Second>
+struct is_trivially_relocatable<std::pair<First, Second>> : std::bool_constant<
+  is_trivially_relocatable_v<First> && is_trivially_relocatable_v<Second>
+> {};
+
+// std::vector holds three pointers in libstdc++ and libc++
+#if defined(__GLIBCXX__) || defined(_LIBCPP_VERSION)
+template<class T>
+struct is_trivially_relocatable<std::vector<T>> : std::true_type {};
+#endif
+
+// libstdc++'s short strings point into the object itself; libc++'s do not
+#if defined(_LIBCPP_VERSION)
+template<class Char, class Traits>
+struct is_trivially_relocatable<std::basic_string<Char, Traits>>
+  : std::true_type {};
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Moves `n` objects from `first` into the uninitialized storage at `dest`
+// and ends the lifetime of the originals: one `memcpy` for trivially
+// relocatable types, move construction and destruction otherwise (copies
+// first if moving may throw, so that the originals survive exceptions).
+// Ranges must not overlap.
+template<class T>
+void uninitialized_relocate_n(T* first, std::size_t n, T* dest) {
+  if constexpr(is_trivially_relocatable_v<T>) {
+    if(n) std::memcpy(static_cast<void*>(dest), first, n * sizeof(T));
+  }
+  else if constexpr(
+    std::is_nothrow_move_constructible_v<T>
+    || !std::is_copy_constructible_v<T>
+  ) {
+    for(std::size_t i=0; i<n; ++i) {
+      ::new(static_cast<void*>(dest + i)) T(std::move(first[i]));
+      first[i].~T();
+    }
+  }
+  else {
+    std::uninitialized_copy_n(first, n, dest);
+    std::destroy_n(first, n);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
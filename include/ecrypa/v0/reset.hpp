@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include <array>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/traits.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// `reset_value<T>::reset(t)` returns `t` to an empty state while keeping the
+// memory it owns for reuse: containers are cleared (their capacity is kept),
+// annotated types are reset item by item, and other types are assigned
+// `T{}`. Specialize it for types that can do better.
+template<class T, class ExpressionSfinae = void>
+struct reset_value {
+  static void reset(T& t) { t = T{}; }
+};
+
+template<class T>
+void reset(T& t) { reset_value<T>::reset(t); }
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Annotated types: bases are reset recursively, trivially copyable members
+// are zeroed (adjacent ones by a single `memset`), other members are reset.
+// Reference and const members are left alone.
+template<class Outer>
+struct reset_value<Outer, std::enable_if_t<is_annotated<Outer>{}>> {
+  static void reset(Outer& outer) {
+    unsigned char* run_begin = nullptr;
+    unsigned char* run_end = nullptr;
+    const auto flush = [&] {
+      if(run_begin) std::memset(run_begin, 0, std::size_t(run_end - run_begin));
+      run_begin = run_end = nullptr;
+    };
+    each_item<Outer>([&] (auto bm) {
+      using Item = decltype(bm);
+      using Inner = typename Item::inner_type;
+      if constexpr(std::is_reference_v<Inner> || std::is_const_v<Inner>) {
+        return;// not owned or not assignable
+      }
+      else if constexpr(
+        Item::is_member && std::is_trivially_copyable_v<Inner>
+      ) {
+        auto p = reinterpret_cast<unsigned char*>(std::addressof(bm(outer)));
+        if(p != run_end) {
+          flush();
+          run_begin = p;
+        }
+        run_end = p + sizeof(Inner);
+      }
+      else {
+        flush();
+        reset_value<Inner>::reset(bm(outer));
+      }
+    });
+    flush();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class C, class Traits, class Alloc>
+struct reset_value<std::basic_string<C, Traits, Alloc>> {
+  static void reset(std::basic_string<C, Traits, Alloc>& s) { s.clear(); }
+};
+
+template<class T, class Alloc>
+struct reset_value<std::vector<T, Alloc>> {
+  static void reset(std::vector<T, Alloc>& v) { v.clear(); }
+};
+
+template<class T, class Alloc>
+struct reset_value<std::deque<T, Alloc>> {
+  static void reset(std::deque<T, Alloc>& d) { d.clear(); }
+};
+
+template<class T, std::size_t N>
+struct reset_value<std::array<T, N>> {
+  static void reset(std::array<T, N>& a) {
+    if constexpr(std::is_trivially_copyable_v<T>) {
+      std::memset(static_cast<void*>(a.data()), 0, sizeof(a));
+    }
+    else {
+      for(T& t : a) reset_value<T>::reset(t);
+    }
+  }
+};
+
+template<class First, class Second>
+struct reset_value<std::pair<First, Second>> {
+  static void reset(std::pair<First, Second>& p) {
+    reset_value<First>::reset(p.first);
+    reset_value<Second>::reset(p.second);
+  }
+};
+
+template<class T>
+struct reset_value<std::optional<T>> {
+  static void reset(std::optional<T>& o) { o.reset(); }
+};
+
+template<class Key, class T, class Compare, class Alloc>
+struct reset_value<std::map<Key, T, Compare, Alloc>> {
+  static void reset(std::map<Key, T, Compare, Alloc>& m) { m.clear(); }
+};
+
+template<class Key, class T, class Compare, class Alloc>
+struct reset_value<std::multimap<Key, T, Compare, Alloc>> {
+  static void reset(std::multimap<Key, T, Compare, Alloc>& m) { m.clear(); }
+};
+
+template<class Key, class Compare, class Alloc>
+struct reset_value<std::set<Key, Compare, Alloc>> {
+  static void reset(std::set<Key, Compare, Alloc>& s) { s.clear(); }
+};
+
+template<class Key, class T, class Hash, class Eq, class Alloc>
+struct reset_value<std::unordered_map<Key, T, Hash, Eq, Alloc>> {
+  static void reset(std::unordered_map<Key, T, Hash, Eq, Alloc>& m) {
+    m.clear();
+  }
+};
+
+template<class Key, class Hash, class Eq, class Alloc>
+struct reset_value<std::unordered_set<Key, Hash, Eq, Alloc>> {
+  static void reset(std::unordered_set<Key, Hash, Eq, Alloc>& s) {
+    s.clear();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
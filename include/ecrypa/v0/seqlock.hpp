@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+#include <ecrypa/v0/items.hpp>
+#include <ecrypa/v0/layout.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline void spin_pause() {
+#if defined(__SSE2__)
+  _mm_pause();
+#endif
+}
+
+// the words `[first, last)` holding the bytes of `item`
+template<class Item>
+std::pair<std::size_t, std::size_t> item_words(Item item) {
+  using Inner = std::decay_t<typename Item::inner_type>;
+  static const auto ret = [&] {
+    const std::size_t offset = item_offset(item);
+    return std::make_pair(offset / 8, (offset + sizeof(Inner) + 7) / 8);
+  }();
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A flat annotated object for many readers and rare writers. Readers never
+// write shared memory: they copy the object with relaxed atomic word loads
+// between two reads of a sequence counter and retry if a writer intervened.
+// Writers exclude each other by making the counter odd.
+// ```
+// ecrypa::seqlock<Pricing> pricing;
+// pricing.store(item<2, Pricing>{}, 1.25);             // writer
+// Pricing snapshot = pricing.load();                   // reader
+// double spread = pricing.load(item<2, Pricing>{});    // reads its words only
+// ```
+template<class Outer>
+class alignas(64) seqlock {
+  static_assert(is_flat_v<Outer>, "seqlock: outer type must be flat");
+  static_assert(
+    std::atomic<std::uint64_t>::is_always_lock_free,
+    "seqlock: needs lock-free 64-bit atomics"
+  );
+
+ public:
+  seqlock() : seqlock(Outer{}) {}
+
+  explicit seqlock(const Outer& outer) {
+    std::uint64_t buf[word_count] = {};
+    std::memcpy(buf, &outer, sizeof(Outer));
+    for(std::size_t i=0; i<word_count; ++i) {
+      words_[i].store(buf[i], std::memory_order_relaxed);
+    }
+  }
+
+  seqlock(const seqlock&) = delete;
+  seqlock& operator=(const seqlock&) = delete;
+
+  Outer load() const {
+    std::uint64_t buf[word_count];
+    read(buf, 0, word_count);
+    Outer ret;
+    std::memcpy(&ret, buf, sizeof(Outer));
+    return ret;
+  }
+
+  template<class Item>
+  auto load(Item item) const {
+    static_assert(std::is_same_v<typename Item::outer_type, Outer>);
+    using Inner = std::decay_t<typename Item::inner_type>;
+    const auto [first, last] = detail::item_words(item);
+    std::uint64_t buf[word_count];
+    read(buf, first, last);
+    const char* bytes = reinterpret_cast<const char*>(buf);
+    Inner ret;
+    std::memcpy(&ret, bytes + item_offset(item), sizeof(Inner));
+    return ret;
+  }
+
+  void store(const Outer& outer) {
+    update([&] (Outer& o) { o = outer; });
+  }
+
+  template<class Item, class Value>
+  void store(Item item, Value&& value) {
+    static_assert(std::is_same_v<typename Item::outer_type, Outer>);
+    update([&] (Outer& o) { item(o) = std::forward<Value>(value); });
+  }
+
+// applies `f(Outer&)` to a copy and publishes the words that changed;
+// if `f` throws, nothing is published and the lock is released
+  template<class F>
+  void update(F&& f) {
+    const std::uint64_t seq = lock();
+    std::uint64_t old[word_count];
+    for(std::size_t i=0; i<word_count; ++i) {
+      old[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    Outer outer;
+    std::memcpy(&outer, old, sizeof(Outer));
+    try {
+      std::forward<F>(f)(outer);
+    } catch(...) {
+      seq_.store(seq, std::memory_order_release);
+      throw;
+    }
+    std::uint64_t buf[word_count];
+    std::memcpy(buf, old, sizeof(buf));
+    std::memcpy(buf, &outer, sizeof(Outer));
+    for(std::size_t i=0; i<word_count; ++i) {
+      if(buf[i] != old[i]) words_[i].store(buf[i], std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+ private:
+  static constexpr std::size_t word_count = (sizeof(Outer) + 7) / 8;
+
+  std::atomic<std::uint64_t> seq_{0};
+  std::atomic<std::uint64_t> words_[word_count];
+
+// copies words `[first, last)` of a consistent version into `buf`
+  void read(std::uint64_t* buf, std::size_t first, std::size_t last) const {
+    for(;;) {
+      const std::uint64_t seq = seq_.load(std::memory_order_acquire);
+      if(seq & 1) {
+        detail::spin_pause();
+        continue;
+      }
+      for(std::size_t i=first; i<last; ++i) {
+        buf[i] = words_[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(seq_.load(std::memory_order_relaxed) == seq) return;
+    }
+  }
+
+// makes the counter odd; returns its even value from before
+  std::uint64_t lock() {
+    std::uint64_t seq = seq_.load(std::memory_order_relaxed);
+    for(;;) {
+      if(seq & 1) {
+        detail::spin_pause();
+        seq = seq_.load(std::memory_order_relaxed);
+      }
+      else if(seq_.compare_exchange_weak(
+        seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed
+      )) {
+        std::atomic_thread_fence(std::memory_order_release);
+        return seq;
+      }
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
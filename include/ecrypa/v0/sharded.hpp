@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <ecrypa/v0/aggregate.hpp>
+#include <ecrypa/v0/items.hpp>
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// small consecutive ids of the threads that touched any `sharded`
+inline std::size_t thread_shard_id() {
+  static std::atomic<std::size_t> next{0};
+  thread_local const std::size_t id =
+    next.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+template<class T>
+T relaxed_load(const T& t) {
+  T ret;
+  __atomic_load(&t, &ret, __ATOMIC_RELAXED);
+  return ret;
+}
+
+template<class T>
+void relaxed_store(T& t, T value) {
+  __atomic_store(&t, &value, __ATOMIC_RELAXED);
+}
+
+// the aggregate of `Aggregates...` for `Item`, or `sum_of<Item>`
+template<class Item, class... Aggregates>
+struct member_aggregate {
+  using type = sum_of<Item>;
+};
+
+template<class Item, class First, class... Rest>
+struct member_aggregate<Item, First, Rest...> {
+  using type = std::conditional_t<
+    std::is_same_v<typename First::item_type, Item>,
+    First,
+    typename member_aggregate<Item, Rest...>::type
+  >;
+};
+
+template<class Item, class... Aggregates>
+using member_aggregate_t =
+  typename member_aggregate<Item, Aggregates...>::type;
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Counters of an annotated struct of arithmetic items, with one
+// cache-line-aligned copy (shard) per thread, so updates from different
+// threads touch different cache lines. `collect` combines the shards item
+// by item: by sum, or by the aggregate given for the item in `Aggregates`
+// (`min_of`, `max_of` or a user type with the same interface).
+// ```
+// ecrypa::sharded<Stats, ecrypa::max_of<ecrypa::item<3, Stats>>> stats;
+// stats.add(ecrypa::item<0, Stats>{});                 // ++requests
+// stats.combine(ecrypa::item<3, Stats>{}, latency);    // max latency
+// Stats total = stats.collect();
+// ```
+// Threads are assigned shards round robin; threads sharing a shard stay
+// correct, since updates are relaxed atomic read-modify-writes.
+template<class Outer, class... Aggregates>
+class sharded {
+  static_assert(
+    apply_items<Outer>([] (auto... bms) {
+      return (... && std::is_arithmetic_v<typename decltype(bms)::inner_type>);
+    }),
+    "sharded: all items must be arithmetic"
+  );
+
+ public:
+  explicit sharded(std::size_t shards = std::thread::hardware_concurrency())
+    : shards_(std::max<std::size_t>(shards, 1))
+  {
+    reset();
+  }
+
+  std::size_t shard_count() const { return shards_.size(); }
+
+// adds `n` to the calling thread's shard of a summed item
+  template<class Item>
+  void add(Item item, typename Item::inner_type n = 1) {
+    static_assert(
+      std::is_same_v<aggregate_t<Item>, sum_of<Item>>,
+      "sharded::add: item is not summed, use combine"
+    );
+    auto& m = item(local().value);
+    if constexpr(std::is_integral_v<typename Item::inner_type>) {
+      __atomic_fetch_add(&m, n, __ATOMIC_RELAXED);
+    }
+    else {
+      update(m, [&] (auto v) { return v + n; });
+    }
+  }
+
+// folds `value` into the calling thread's shard of `item` with its aggregate
+  template<class Item>
+  void combine(Item item, typename Item::inner_type value) {
+    using Aggregate = aggregate_t<Item>;
+    using Inner = typename Item::inner_type;
+    update(item(local().value), [&] (Inner v) {
+      return Inner(Aggregate::combine(v, value));
+    });
+  }
+
+  Outer collect() const {
+    Outer ret{};
+    each_item<Outer>([&] (auto bm) {
+      using Item = decltype(bm);
+      using Aggregate = aggregate_t<Item>;
+      using Inner = typename Item::inner_type;
+      auto r = Aggregate::identity();
+      for(const shard& s : shards_) {
+        r = Aggregate::combine(r, detail::relaxed_load(bm(s.value)));
+      }
+      bm(ret) = Inner(r);
+    });
+    return ret;
+  }
+
+// sets every shard to the identities of the aggregates; updates racing
+// with `reset` may be lost
+  void reset() {
+    for(shard& s : shards_) {
+      each_item<Outer>([&] (auto bm) {
+        using Inner = typename decltype(bm)::inner_type;
+        using Aggregate = aggregate_t<decltype(bm)>;
+        detail::relaxed_store(bm(s.value), Inner(Aggregate::identity()));
+      });
+    }
+  }
+
+ private:
+  struct alignas(64) shard {
+    Outer value;
+  };
+
+  template<class Item>
+  using aggregate_t = detail::member_aggregate_t<Item, Aggregates...>;
+
+  std::vector<shard> shards_;
+
+  shard& local() {
+    return shards_[detail::thread_shard_id() % shards_.size()];
+  }
+
+  template<class T, class F>
+  static void update(T& t, F f) {
+    T expected = detail::relaxed_load(t);
+    for(;;) {
+      T desired = f(expected);
+      if(__atomic_compare_exchange(
+        &t, &expected, &desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+      )) {
+        return;
+      }
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ecrypa/v0/layout.hpp>
+#include <ecrypa/v0/mapped_vector.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Whether one or several producers write to a `shm_ring`; fixed at creation
+// and checked on opening.
+enum class shm_producers : std::uint64_t { single = 1, multiple = 2 };
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+constexpr char shm_ring_magic[8] = {'e', 'c', 'r', 'y', 'p', 'a', 's', 'r'};
+
+// Follows the layout written by `write_mapped_layout`, at
+// `mapped_data_offset`; the slots follow at the header's `data_offset`.
+struct shm_ring_control {
+  std::uint64_t producers;
+// next position to write, and to read
+  alignas(64) std::atomic<std::uint64_t> head;
+  alignas(64) std::atomic<std::uint64_t> tail;
+};
+
+// `sequence` is the position the slot is next written at while free, and
+// that position + 1 once written
+template<class Outer>
+struct shm_ring_slot {
+  std::atomic<std::uint64_t> sequence;
+  Outer value;
+};
+
+template<class Outer>
+std::size_t shm_ring_data_offset() {
+  return round_up(
+    mapped_data_offset<Outer>() + sizeof(shm_ring_control),
+    std::max<std::size_t>(alignof(shm_ring_slot<Outer>), 64)
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A bounded queue of flat annotated records in POSIX shared memory, from one
+// or several producer processes (per `Producers`) to one consumer process.
+// The segment starts with the annotated layout of `Outer` (names, type
+// names, offsets and sizes of its items, as in `mapped_vector`), which
+// `open` checks against its own `Outer`, throwing `layout_mismatch`.
+// Records are written and read in place, without serialization:
+// ```
+// auto ring = ecrypa::shm_ring<Quote>::create("/quotes", 1 << 16);
+// ring.try_write([&] (Quote& q) { q.bid = bid; q.ask = ask; });
+//
+// auto ring = ecrypa::shm_ring<Quote>::open("/quotes");// consumer
+// ring.try_read([&] (const Quote& q) { ... });
+// ```
+// Writers and readers never block: `try_write` fails on a full ring and
+// `try_read` on an empty one. The segment persists until `unlink`.
+template<class Outer, shm_producers Producers = shm_producers::single>
+class shm_ring {
+  static_assert(is_flat_v<Outer>, "shm_ring: `Outer` must be flat");
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+  using control = detail::shm_ring_control;
+  using slot = detail::shm_ring_slot<Outer>;
+
+ public:
+// creates the segment `name` (which must not exist) with room for
+// `capacity` records, rounded up to a power of two of at least 2 (with one
+// slot, a free slot and a written one would share a sequence number)
+  static shm_ring create(const std::string& name, std::size_t capacity) {
+    std::size_t n = 2;
+    while(n < capacity) n *= 2;
+
+    shm_ring ret;
+    ret.fd_ = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(ret.fd_ < 0) detail::throw_errno("shm_ring: shm_open");
+    try {
+      const std::size_t data_offset = detail::shm_ring_data_offset<Outer>();
+      const std::size_t size = data_offset + n * sizeof(slot);
+      if(::ftruncate(ret.fd_, off_t(size)) != 0) {
+        detail::throw_errno("shm_ring: ftruncate");
+      }
+      ret.map_(size);
+
+      auto base = ret.base_;
+      auto c = ::new(base + detail::mapped_data_offset<Outer>()) control{};
+      c->producers = std::uint64_t(Producers);
+      for(std::size_t i=0; i<n; ++i) {
+        ::new(base + data_offset + i * sizeof(slot)) slot{{i}, {}};
+      }
+      detail::write_mapped_layout<Outer>(
+        base, detail::shm_ring_magic, data_offset, n
+      );
+    }
+    catch(...) {
+      ::shm_unlink(name.c_str());
+      throw;
+    }
+    ret.attach_();
+    return ret;
+  }
+
+// opens the segment `name` created by `create` for the same `Outer`
+  static shm_ring open(const std::string& name) {
+    shm_ring ret;
+    ret.fd_ = ::shm_open(name.c_str(), O_RDWR, 0);
+    if(ret.fd_ < 0) detail::throw_errno("shm_ring: shm_open");
+    struct stat st{};
+    if(::fstat(ret.fd_, &st) != 0) detail::throw_errno("shm_ring: fstat");
+    ret.map_(std::size_t(st.st_size));
+
+    detail::validate_mapped_layout<Outer>(
+      ret.base_, ret.map_size_, detail::shm_ring_magic,
+      detail::shm_ring_data_offset<Outer>(), sizeof(slot), "shm_ring: "
+    );
+    ret.attach_();
+    if(ret.capacity() < 2 || (ret.mask_ & (ret.mask_ + 1))) {
+      throw layout_mismatch("shm_ring: capacity is not a power of two >= 2");
+    }
+    if(ret.control_->producers != std::uint64_t(Producers)) {
+      throw layout_mismatch("shm_ring: producer count differs");
+    }
+    return ret;
+  }
+
+  static void unlink(const std::string& name) {
+    if(::shm_unlink(name.c_str()) != 0) {
+      detail::throw_errno("shm_ring: shm_unlink");
+    }
+  }
+
+  shm_ring(shm_ring&& other) noexcept
+    : fd_{std::exchange(other.fd_, -1)}
+    , map_size_{std::exchange(other.map_size_, 0)}
+    , base_{std::exchange(other.base_, nullptr)}
+    , control_{std::exchange(other.control_, nullptr)}
+    , slots_{std::exchange(other.slots_, nullptr)}
+    , mask_{std::exchange(other.mask_, 0)}
+  {}
+
+  shm_ring& operator=(shm_ring&& other) noexcept {
+    if(this != &other) {
+      close_();
+      fd_ = std::exchange(other.fd_, -1);
+      map_size_ = std::exchange(other.map_size_, 0);
+      base_ = std::exchange(other.base_, nullptr);
+      control_ = std::exchange(other.control_, nullptr);
+      slots_ = std::exchange(other.slots_, nullptr);
+      mask_ = std::exchange(other.mask_, 0);
+    }
+    return *this;
+  }
+
+  ~shm_ring() { close_(); }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+// Calls `f(Outer&)` on the next free slot and publishes it; false if the
+// ring is full. `f` must not throw: a claimed slot is always published.
+  template<class F>
+  bool try_write(F&& f) {
+    std::uint64_t pos = control_->head.load(std::memory_order_relaxed);
+    slot* s;
+    for(;;) {
+      s = &slots_[pos & mask_];
+      const std::uint64_t seq = s->sequence.load(std::memory_order_acquire);
+      if(seq != pos) {
+        if(std::int64_t(seq - pos) < 0) return false;// full
+        pos = control_->head.load(std::memory_order_relaxed);
+      }
+      else if constexpr(Producers == shm_producers::single) {
+        control_->head.store(pos + 1, std::memory_order_relaxed);
+        break;
+      }
+      else if(control_->head.compare_exchange_weak(
+        pos, pos + 1, std::memory_order_relaxed
+      )) {
+        break;
+      }
+    }
+    f(s->value);
+    s->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_push(const Outer& outer) {
+    return try_write([&] (Outer& value) {
+      std::memcpy(static_cast<void*>(&value), &outer, sizeof(Outer));
+    });
+  }
+
+// Calls `f(const Outer&)` on the oldest record and frees its slot; false if
+// the ring is empty. Single consumer only.
+  template<class F>
+  bool try_read(F&& f) {
+    const std::uint64_t pos = control_->tail.load(std::memory_order_relaxed);
+    slot& s = slots_[pos & mask_];
+    if(s.sequence.load(std::memory_order_acquire) != pos + 1) return false;
+    f(static_cast<const Outer&>(s.value));
+    s.sequence.store(pos + capacity(), std::memory_order_release);
+    control_->tail.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool try_pop(Outer& outer) {
+    return try_read([&] (const Outer& value) {
+      std::memcpy(static_cast<void*>(&outer), &value, sizeof(Outer));
+    });
+  }
+
+ private:
+  int fd_ = -1;
+  std::size_t map_size_ = 0;
+  unsigned char* base_ = nullptr;
+  control* control_ = nullptr;
+  slot* slots_ = nullptr;
+  std::size_t mask_ = 0;
+
+  shm_ring() = default;
+
+  void map_(std::size_t size) {
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if(p == MAP_FAILED) detail::throw_errno("shm_ring: mmap");
+    base_ = static_cast<unsigned char*>(p);
+    map_size_ = size;
+  }
+
+  void attach_() {
+    const auto& header = *reinterpret_cast<mapped_file_header*>(base_);
+    control_ = reinterpret_cast<control*>(
+      base_ + detail::mapped_data_offset<Outer>()
+    );
+    slots_ = reinterpret_cast<slot*>(base_ + header.data_offset);
+    mask_ = header.capacity - 1;
+  }
+
+  void close_() {
+    if(base_ != nullptr) ::munmap(base_, map_size_);
+    if(fd_ >= 0) ::close(fd_);
+    base_ = nullptr;
+    fd_ = -1;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,415 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// `sort_key_encoding<T>::append(key, t)` appends bytes to `key` such that the
+// lexicographic order of the bytes (as unsigned char) matches `operator<` on
+// `T`, and no encoding is a proper prefix of another. Encodings of constant
+// length also provide `fixed_size` and `encode(unsigned char* out, t)`.
+// Specialize for more types.
+template<class T, class ExpressionSfinae = void>
+struct sort_key_encoding;
+
+template<class Encoding, class T>
+void append_fixed_size_encoding(std::string& key, T t) {
+  unsigned char buf[Encoding::fixed_size];
+  Encoding::encode(buf, t);
+  key.append(reinterpret_cast<const char*>(buf), sizeof(buf));
+}
+
+template<>
+struct sort_key_encoding<bool> {
+  static constexpr std::size_t fixed_size = 1;
+  static void encode(unsigned char* out, bool b) { *out = b ? 1 : 0; }
+  static void append(std::string& key, bool b) { key.push_back(b ? 1 : 0); }
+};
+
+// big-endian, sign bit flipped for signed types
+template<class T>
+struct sort_key_encoding<
+  T,
+  std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>
+> {
+  static constexpr std::size_t fixed_size = sizeof(T);
+
+  static void encode(unsigned char* out, T t) {
+    using U = std::make_unsigned_t<T>;
+    U u = static_cast<U>(t);
+    if constexpr(std::is_signed_v<T>) u ^= U(U(1) << (8 * sizeof(U) - 1));
+    for(std::size_t i=0; i<sizeof(U); ++i) {
+      out[i] = static_cast<unsigned char>(u >> (8 * (sizeof(U) - 1 - i)));
+    }
+  }
+  static void append(std::string& key, T t) {
+    append_fixed_size_encoding<sort_key_encoding>(key, t);
+  }
+};
+
+template<class T>
+struct sort_key_encoding<T, std::enable_if_t<std::is_enum_v<T>>> {
+  using U = std::underlying_type_t<T>;
+  static constexpr std::size_t fixed_size = sizeof(U);
+
+  static void encode(unsigned char* out, T t) {
+    sort_key_encoding<U>::encode(out, static_cast<U>(t));
+  }
+  static void append(std::string& key, T t) {
+    append_fixed_size_encoding<sort_key_encoding>(key, t);
+  }
+};
+
+// IEEE 754: flip the sign bit of positives, all bits of negatives; -0.0 and
+// +0.0 encode differently (-0.0 first), NaNs sort to either end
+template<class T>
+struct sort_key_encoding<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8);
+  using Bits =
+    std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+  static constexpr std::size_t fixed_size = sizeof(Bits);
+
+  static void encode(unsigned char* out, T t) {
+    Bits bits;
+    std::memcpy(&bits, &t, sizeof(bits));
+    constexpr Bits sign = Bits(1) << (8 * sizeof(Bits) - 1);
+    bits = (bits & sign) ? Bits(~bits) : Bits(bits | sign);
+    sort_key_encoding<Bits>::encode(out, bits);
+  }
+  static void append(std::string& key, T t) {
+    append_fixed_size_encoding<sort_key_encoding>(key, t);
+  }
+};
+
+// strings: 0x00 is escaped as 0x00 0xff, the end is marked by 0x00 0x00
+template<>
+struct sort_key_encoding<std::string_view> {
+  static void append(std::string& key, std::string_view sv) {
+    for(char c : sv) {
+      key.push_back(c);
+      if(c == '\0') key.push_back('\xff');
+    }
+    key.push_back('\0');
+    key.push_back('\0');
+  }
+};
+
+template<class Traits, class Alloc>
+struct sort_key_encoding<std::basic_string<char, Traits, Alloc>> {
+  static void append(std::string& key, std::string_view sv) {
+    sort_key_encoding<std::string_view>::append(key, sv);
+  }
+};
+
+template<class T, class ExpressionSfinae = void>
+struct sort_key_fixed_size : std::integral_constant<std::size_t, 0> {};
+
+template<class T>
+struct sort_key_fixed_size<
+  T, std::void_t<decltype(sort_key_encoding<std::decay_t<T>>::fixed_size)>
+> : std::integral_constant<
+  std::size_t, sort_key_encoding<std::decay_t<T>>::fixed_size
+> {};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Order-preserving byte string of the selected members of `Outer`: comparing
+// two keys bytewise orders by the first member, then the second, and so on.
+template<class Outer, class... Items>
+struct sort_key {
+  static_assert(sizeof...(Items) > 0);
+  static_assert(
+    (... && std::is_same_v<typename Items::outer_type, Outer>),
+    "sort_key: items must be item handles of `Outer`"
+  );
+
+  static void append(std::string& key, const Outer& outer) {
+    (..., append_item(key, Items{}(outer)));
+  }
+
+  static std::string make(const Outer& outer) {
+    std::string ret;
+    append(ret, outer);
+    return ret;
+  }
+
+// length of every key, or 0 if the length varies
+  static constexpr std::size_t fixed_size =
+    (... && (sort_key_fixed_size<typename Items::inner_type>{} != 0))
+    ? (std::size_t{0} + ... + sort_key_fixed_size<typename Items::inner_type>{})
+    : 0;
+
+// writes `fixed_size` bytes
+  static void encode(unsigned char* out, const Outer& outer) {
+    static_assert(fixed_size != 0, "sort_key: key length varies");
+    (..., encode_item(out, Items{}(outer)));
+  }
+
+ private:
+  template<class Inner>
+  static void encode_item(unsigned char*& out, const Inner& inner) {
+    sort_key_encoding<std::decay_t<Inner>>::encode(out, inner);
+    out += sort_key_fixed_size<Inner>{};
+  }
+
+  template<class Inner>
+  static void append_item(std::string& key, const Inner& inner) {
+    sort_key_encoding<std::decay_t<Inner>>::append(key, inner);
+  }
+};
+
+template<class Outer, class... Items>
+std::string make_sort_key(const Outer& outer, Items...) {
+  return sort_key<Outer, Items...>::make(outer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Stable MSD radix sort of a permutation by keys stored back to back in
+// `bytes` (key `i` spans `[offsets[i], offsets[i+1])`). Bucket 0 collects keys
+// that end at the current depth, buckets 1..256 the byte values.
+inline void radix_sort_permutation(
+  const std::string& bytes,
+  const std::vector<std::size_t>& offsets,
+  std::vector<std::size_t>& perm
+) {
+  constexpr std::size_t small_range = 64;
+
+  const auto bucket = [&] (std::size_t i, std::size_t depth) -> std::size_t {
+    std::size_t pos = offsets[i] + depth;
+    if(pos >= offsets[i + 1]) return 0;
+    return 1 + static_cast<unsigned char>(bytes[pos]);
+  };
+
+  const auto key = [&] (std::size_t i) {
+    std::size_t first = offsets[i];
+    return std::string_view{bytes}.substr(first, offsets[i + 1] - first);
+  };
+
+  const auto less_from = [&] (std::size_t depth) {
+    return [&, depth] (std::size_t lhs, std::size_t rhs) {
+      // `char_traits<char>::compare` orders as unsigned char
+      int cmp = key(lhs).substr(depth).compare(key(rhs).substr(depth));
+      return cmp < 0 || (cmp == 0 && lhs < rhs);
+    };
+  };
+
+  struct range { std::size_t first, last, depth; };
+  std::vector<range> todo{{0, perm.size(), 0}};
+  std::vector<std::size_t> scratch(perm.size());
+
+  while(!todo.empty()) {
+    range r = todo.back();
+    todo.pop_back();
+
+    if(r.last - r.first <= small_range) {
+      auto first = perm.begin() + r.first;
+      auto last = perm.begin() + r.last;
+      std::sort(first, last, less_from(r.depth));
+      continue;
+    }
+
+    std::size_t counts[257 + 1]{};// counts[b] becomes the start of bucket b
+    for(std::size_t i=r.first; i<r.last; ++i) {
+      ++counts[1 + bucket(perm[i], r.depth)];
+    }
+    for(std::size_t b=1; b<=257; ++b) counts[b] += counts[b - 1];
+
+    std::size_t starts[257];
+    std::copy(counts, counts + 257, starts);
+    for(std::size_t i=r.first; i<r.last; ++i) {
+      std::size_t p = perm[i];
+      scratch[r.first + starts[bucket(p, r.depth)]++] = p;
+    }
+    std::copy(
+      scratch.begin() + r.first, scratch.begin() + r.last,
+      perm.begin() + r.first
+    );
+
+    // bucket 0 holds equal keys, already in original order
+    for(std::size_t b=1; b<257; ++b) {
+      if(counts[b + 1] - counts[b] > 1) {
+        todo.push_back(
+          {r.first + counts[b], r.first + counts[b + 1], r.depth + 1}
+        );
+      }
+    }
+  }
+}
+
+// Stable MSD radix sort of fixed-size keys that carry their original index.
+// The records themselves are moved, so every pass streams through memory;
+// passes alternate between `keys` and a scratch buffer.
+template<std::size_t width, class Index>
+struct fixed_key {
+  unsigned char bytes[width];
+  Index idx;
+};
+
+template<std::size_t width, class Index>
+void radix_sort_fixed(fixed_key<width, Index>* keys, std::size_t size) {
+  using Key = fixed_key<width, Index>;
+  constexpr std::size_t small_range = 32;
+
+  // insertion sort; ties keep their (original) order
+  const auto small_sort = [] (Key* first, Key* last, std::size_t depth) {
+    for(Key* i=first+1; i<last; ++i) {
+      Key k = *i;
+      Key* j = i;
+      for(; j>first; --j) {
+        const unsigned char* prev = (j - 1)->bytes + depth;
+        if(std::memcmp(k.bytes + depth, prev, width - depth) >= 0) break;
+        *j = *(j - 1);
+      }
+      *j = k;
+    }
+  };
+
+  // first byte position (at least `depth`) where the keys differ
+  const auto common_prefix = [] (Key* first, Key* last, std::size_t depth) {
+    std::size_t ret = width;
+    for(Key* i=first+1; i<last && ret>depth; ++i) {
+      std::size_t d = depth;
+      while(d < ret && i->bytes[d] == first->bytes[d]) ++d;
+      ret = d;
+    }
+    return ret;
+  };
+
+  std::unique_ptr<Key[]> scratch{new Key[size]};
+  Key* buffers[2] = {keys, scratch.get()};
+
+  struct range { std::size_t first, last, depth; int buffer; };
+  std::vector<range> todo{{0, size, 0, 0}};
+
+  while(!todo.empty()) {
+    range r = todo.back();
+    todo.pop_back();
+    Key* first = buffers[r.buffer] + r.first;
+    Key* last = buffers[r.buffer] + r.last;
+
+    if(r.last - r.first <= small_range) {
+      if(r.buffer != 0) {
+        std::copy(first, last, keys + r.first);
+        first = keys + r.first;
+        last = keys + r.last;
+      }
+      small_sort(first, last, r.depth);
+      continue;
+    }
+
+    const std::size_t depth = common_prefix(first, last, r.depth);
+    if(depth == width) {// equal keys, already in original order
+      if(r.buffer != 0) std::copy(first, last, keys + r.first);
+      continue;
+    }
+
+    std::size_t counts[256 + 1]{};// counts[b] becomes the start of bucket b
+    for(Key* k=first; k<last; ++k) ++counts[1 + k->bytes[depth]];
+    for(std::size_t b=1; b<=256; ++b) counts[b] += counts[b - 1];
+
+    std::size_t starts[256];
+    std::copy(counts, counts + 256, starts);
+    Key* out = buffers[1 - r.buffer] + r.first;
+    for(Key* k=first; k<last; ++k) out[starts[k->bytes[depth]]++] = *k;
+
+    for(std::size_t b=0; b<256; ++b) {
+      std::size_t bucket_first = r.first + counts[b];
+      std::size_t bucket_last = r.first + counts[b + 1];
+      if(bucket_first == bucket_last) continue;
+      todo.push_back({bucket_first, bucket_last, depth + 1, 1 - r.buffer});
+    }
+  }
+}
+
+// `data[i] = data[source(i)]` for all `i`: gathered into a buffer (reads are
+// random, writes sequential), then moved back
+template<class Outer, class Source>
+void permute(Outer* data, std::size_t size, Source&& source) {
+  std::vector<Outer> sorted;
+  sorted.reserve(size);
+  for(std::size_t i=0; i<size; ++i) {
+    sorted.push_back(std::move(data[source(i)]));
+  }
+  std::move(sorted.begin(), sorted.end(), data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Stable sort of a contiguous range of `Outer` by `sort_key<Outer, Items...>`,
+// i.e. by the given members in order. Keys are built once per element; the
+// elements are moved exactly twice.
+template<class Range, class... Items>
+void radix_sort(Range&& range, Items...) {
+  using Outer = std::remove_pointer_t<decltype(std::data(range))>;
+  using Key = sort_key<std::remove_const_t<Outer>, Items...>;
+  static_assert(!std::is_const_v<Outer>, "radix_sort: range must be mutable");
+
+  Outer* data = std::data(range);
+  std::size_t size = std::size(range);
+
+  const auto sort_fixed = [&] (auto index) {
+    using FixedKey = detail::fixed_key<Key::fixed_size, decltype(index)>;
+    std::unique_ptr<FixedKey[]> keys{new FixedKey[size]};
+    for(std::size_t i=0; i<size; ++i) {
+      Key::encode(keys[i].bytes, data[i]);
+      keys[i].idx = static_cast<decltype(index)>(i);
+    }
+    detail::radix_sort_fixed(keys.get(), size);
+    detail::permute(data, size, [&] (std::size_t i) { return keys[i].idx; });
+  };
+
+  if constexpr(Key::fixed_size != 0) {
+    if(size <= UINT32_MAX) sort_fixed(std::uint32_t{});// smaller records
+    else sort_fixed(std::size_t{});
+  }
+  else {
+    std::string bytes;
+    std::vector<std::size_t> offsets;
+    offsets.reserve(size + 1);
+    offsets.push_back(0);
+    for(std::size_t i=0; i<size; ++i) {
+      Key::append(bytes, data[i]);
+      offsets.push_back(bytes.size());
+    }
+    std::vector<std::size_t> perm(size);
+    for(std::size_t i=0; i<size; ++i) perm[i] = i;
+    detail::radix_sort_permutation(bytes, offsets, perm);
+    detail::permute(data, size, [&] (std::size_t i) { return perm[i]; });
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
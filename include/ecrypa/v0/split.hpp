@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <ecrypa/v0/items.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Where `split<Outer>` stores a member: `hot` members together, `cold` ones
+// out of line, and members `owned` by a writer thread on cache lines of
+// their own, one group per `writer`.
+struct member_placement {
+  enum kind_type : unsigned char { hot, cold, owned };
+
+  kind_type kind = hot;
+  unsigned char writer = 0;
+};
+
+constexpr member_placement hot_member{member_placement::hot, 0};
+constexpr member_placement cold_member{member_placement::cold, 0};
+
+constexpr member_placement owned_by(unsigned char writer) {
+  return {member_placement::owned, writer};
+}
+
+// Placements are given per item through an ADL hook; without one, all
+// members are hot:
+// ```
+// struct Order {
+//   std::uint64_t id;
+//   double price;
+//   std::string note;
+//
+//   friend constexpr auto member_placements(Order*) {
+//     return std::array{
+//       ecrypa::hot_member, ecrypa::owned_by(1), ecrypa::cold_member
+//     };
+//   }
+//   template<class A> friend constexpr auto annotate(A a, Order*) { ... }
+// };
+// ```
+template<class Outer, class ExpressionSfinae = void>
+struct has_member_placements : std::false_type {};
+
+template<class Outer>
+struct has_member_placements<
+  Outer,
+  std::void_t<decltype(member_placements(static_cast<Outer*>(nullptr)))>
+> : std::true_type {};
+
+template<class Outer>
+constexpr member_placement member_placement_of(std::size_t idx) {
+  if constexpr(has_member_placements<Outer>{}) {
+    constexpr auto placements =
+      member_placements(static_cast<Outer*>(nullptr));
+    static_assert(placements.size() == items<Outer>::count);
+    return placements[idx];
+  }
+  else {
+    return hot_member;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class Outer, std::size_t idx>
+using split_member_t = std::decay_t<typename item<idx, Outer>::inner_type>;
+
+template<class Outer>
+struct split_layout {
+  static constexpr std::size_t count = items<Outer>::count;
+
+  template<std::size_t... is>
+  static constexpr std::array<std::size_t, count> make_aligns(
+    std::index_sequence<is...>
+  ) {
+    return {alignof(split_member_t<Outer, is>)...};
+  }
+  static constexpr auto aligns = make_aligns(items<Outer>::ind_seq);
+
+  static constexpr bool same_group(
+    member_placement a, member_placement b
+  ) {
+    return a.kind == b.kind
+      && (a.kind != member_placement::owned || a.writer == b.writer);
+  }
+
+// the items placed like `p`, by decreasing alignment to avoid padding
+  struct selection {
+    std::array<std::size_t, count> indices{};
+    std::size_t size = 0;
+  };
+  static constexpr selection select(member_placement p) {
+    std::size_t max_align = 1;
+    for(std::size_t a : aligns) max_align = a > max_align ? a : max_align;
+    selection ret;
+    for(std::size_t align = max_align; align; align /= 2) {
+      for(std::size_t i=0; i<count; ++i) {
+        if(
+          same_group(member_placement_of<Outer>(i), p)
+          && aligns[i] == align
+        ) {
+          ret.indices[ret.size++] = i;
+        }
+      }
+    }
+    return ret;
+  }
+
+  static constexpr selection make_writers() {
+    selection ret;
+    for(std::size_t i=0; i<count; ++i) {
+      auto p = member_placement_of<Outer>(i);
+      bool seen = p.kind != member_placement::owned;
+      for(std::size_t j=0; j<ret.size; ++j) seen |= ret.indices[j] == p.writer;
+      if(!seen) ret.indices[ret.size++] = p.writer;
+    }
+    return ret;
+  }
+// distinct writer ids, in order of first appearance
+  static constexpr selection writers = make_writers();
+
+  static constexpr std::size_t lane_of(unsigned char writer) {
+    std::size_t k = 0;
+    while(writers.indices[k] != writer) ++k;
+    return k;
+  }
+
+// position of item `i` within its group
+  static constexpr std::size_t position(std::size_t i) {
+    const auto s = select(member_placement_of<Outer>(i));
+    std::size_t j = 0;
+    while(s.indices[j] != i) ++j;
+    return j;
+  }
+
+  template<member_placement::kind_type kind, unsigned char writer>
+  struct group {
+    static constexpr selection s = select({kind, writer});
+
+    template<std::size_t... js>
+    static auto make_tuple(std::index_sequence<js...>)
+      -> std::tuple<split_member_t<Outer, s.indices[js]>...>;
+
+    using type = decltype(make_tuple(std::make_index_sequence<s.size>{}));
+  };
+
+  using hot_type = typename group<member_placement::hot, 0>::type;
+  using cold_type = typename group<member_placement::cold, 0>::type;
+
+  template<class Members>
+  struct alignas(64) lane {
+    Members members;
+  };
+
+  template<std::size_t... ks>
+  static auto make_lanes(std::index_sequence<ks...>) -> std::tuple<
+    lane<typename group<
+      member_placement::owned, static_cast<unsigned char>(writers.indices[ks])
+    >::type>...
+  >;
+
+  using lanes_type = decltype(make_lanes(
+    std::make_index_sequence<writers.size>{}
+  ));
+};
+
+// the power of two at least `size`, up to a cache line
+constexpr std::size_t split_align(std::size_t size) {
+  std::size_t ret = 1;
+  while(ret < size && ret < 64) ret *= 2;
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Storage of an annotated object split by `member_placements`: hot members
+// packed together (by decreasing alignment, and aligned so that they do not
+// straddle cache lines when up to 64 bytes), cold members behind a pointer,
+// and each writer's owned members on separate cache lines. Members are
+// accessed by item handle:
+// ```
+// ecrypa::split<Order> order{o};
+// order[ecrypa::item<1, Order>{}] += 0.5;
+// Order copy = order.to_outer();
+// ```
+// A `std::vector<split<Order>>` thus scans hot members without touching
+// cold ones.
+template<class Outer>
+class alignas(
+  detail::split_layout<Outer>::writers.size
+  ? 64
+  : detail::split_align(
+      sizeof(typename detail::split_layout<Outer>::hot_type) + sizeof(void*)
+    )
+) split {
+  using layout = detail::split_layout<Outer>;
+  using hot_type = typename layout::hot_type;
+  using cold_type = typename layout::cold_type;
+  using lanes_type = typename layout::lanes_type;
+
+  static constexpr bool has_cold = std::tuple_size_v<cold_type> != 0;
+
+  static_assert(
+    items<Outer>::apply([] (auto... bms) {
+      return (... && (
+        bms.is_member
+        && !std::is_reference_v<typename decltype(bms)::inner_type>
+      ));
+    }),
+    "split: all items must be nonreference members"
+  );
+
+ public:
+  split() : cold_{make_cold()} {}
+
+  explicit split(const Outer& outer) : split() {
+    each_item<Outer>([&] (auto bm) { (*this)[bm] = bm(outer); });
+  }
+
+  split(const split& other)
+    : hot_{other.hot_},
+      cold_{other.cold_ ? std::make_unique<cold_type>(*other.cold_) : nullptr},
+      lanes_{other.lanes_}
+  {}
+
+  split& operator=(const split& other) {
+    hot_ = other.hot_;
+    if(!other.cold_) cold_.reset();
+    else if(cold_) *cold_ = *other.cold_;
+    else cold_ = std::make_unique<cold_type>(*other.cold_);
+    lanes_ = other.lanes_;
+    return *this;
+  }
+
+// a moved-from `split` has no cold block: it may be assigned to, copied or
+// destroyed, but its cold members not accessed
+  split(split&&) = default;
+  split& operator=(split&&) = default;
+
+  template<class Item>
+  auto& operator[](Item item) {
+    return get(*this, item);
+  }
+
+  template<class Item>
+  const auto& operator[](Item item) const {
+    return get(*this, item);
+  }
+
+  Outer to_outer() const {
+    Outer ret{};
+    each_item<Outer>([&] (auto bm) { bm(ret) = (*this)[bm]; });
+    return ret;
+  }
+
+ private:
+  hot_type hot_{};
+  std::unique_ptr<cold_type> cold_;
+  lanes_type lanes_{};
+
+  static std::unique_ptr<cold_type> make_cold() {
+    return has_cold ? std::make_unique<cold_type>() : nullptr;
+  }
+
+  template<class Self, class Item>
+  static auto& get(Self& self, Item) {
+    static_assert(std::is_same_v<typename Item::outer_type, Outer>);
+    constexpr std::size_t i = Item::idx;
+    constexpr member_placement p = member_placement_of<Outer>(i);
+    constexpr std::size_t j = layout::position(i);
+    if constexpr(p.kind == member_placement::hot) {
+      return std::get<j>(self.hot_);
+    }
+    else if constexpr(p.kind == member_placement::cold) {
+      return std::get<j>(*self.cold_);
+    }
+    else {
+      constexpr std::size_t k = layout::lane_of(p.writer);
+      return std::get<j>(std::get<k>(self.lanes_).members);
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+
+#include <map>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ecrypa/v0/items.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Secondary index declarations for `table`: `Item` is a member handle
+// `item<idx, Outer>`; several rows may share a key. Each index keeps, per
+// row, the `position_type` of its entry, so that a row is unlinked without
+// searching among the rows sharing its key.
+
+// Rows by key in a hash map of row id vectors; a row's position is its
+// index in the vector, which is filled from the back on unlinking.
+template<class Item>
+struct hash_index {
+  using item_type = Item;
+  using key_type = std::decay_t<typename Item::inner_type>;
+  using container_type = std::unordered_map<key_type, std::vector<std::size_t>>;
+  using position_type = std::size_t;
+
+  static void link(
+    container_type& c, std::vector<position_type>& positions,
+    std::size_t row, const key_type& key
+  ) {
+    auto it = c.try_emplace(key).first;
+    std::vector<std::size_t>& rows = it->second;
+    try {
+      rows.push_back(row);
+    }
+    catch(...) {
+      if(rows.empty()) c.erase(it);
+      throw;
+    }
+    positions[row] = rows.size() - 1;
+  }
+
+  static void unlink(
+    container_type& c, std::vector<position_type>& positions,
+    std::size_t row, const key_type& key
+  ) {
+    auto it = c.find(key);
+    assert(it != c.end() && "table: index out of sync");
+    std::vector<std::size_t>& rows = it->second;
+    const std::size_t moved = rows.back();
+    rows[positions[row]] = moved;
+    positions[moved] = positions[row];
+    rows.pop_back();
+    if(rows.empty()) c.erase(it);
+  }
+
+  template<class Key>
+  static const std::size_t* find(const container_type& c, const Key& key) {
+    auto it = c.find(key);
+    return it == c.end() ? nullptr : it->second.data();
+  }
+
+// `[first, last)` of row ids
+  template<class Key>
+  static auto equal_range(const container_type& c, const Key& key) {
+    using rows_range = std::pair<const std::size_t*, const std::size_t*>;
+    auto it = c.find(key);
+    if(it == c.end()) return rows_range{};
+    const std::vector<std::size_t>& rows = it->second;
+    return rows_range{rows.data(), rows.data() + rows.size()};
+  }
+};
+
+// Rows by key in a multimap; a row's position is its multimap iterator.
+template<class Item>
+struct ordered_index {
+  using item_type = Item;
+  using key_type = std::decay_t<typename Item::inner_type>;
+  using container_type = std::multimap<key_type, std::size_t>;
+  using position_type = typename container_type::iterator;
+
+  static void link(
+    container_type& c, std::vector<position_type>& positions,
+    std::size_t row, const key_type& key
+  ) {
+    positions[row] = c.emplace(key, row);
+  }
+
+  static void unlink(
+    container_type& c, std::vector<position_type>& positions,
+    std::size_t row, const key_type&
+  ) {
+    c.erase(positions[row]);
+  }
+
+  template<class Key>
+  static const std::size_t* find(const container_type& c, const Key& key) {
+    auto it = c.find(key);
+    return it == c.end() ? nullptr : &it->second;
+  }
+
+// `[first, last)` of `(key, row_id)` pairs
+  template<class Key>
+  static auto equal_range(const container_type& c, const Key& key) {
+    return c.equal_range(key);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Owns annotated records under stable row ids and keeps the declared
+// secondary indexes in sync on `insert`, `update` and `erase`.
+// ```
+// ecrypa::table<Order,
+//   ecrypa::hash_index<ecrypa::item<0, Order>>,    // O(1) by id
+//   ecrypa::ordered_index<ecrypa::item<3, Order>>  // O(log n) by timestamp
+// > orders;
+// auto row = orders.insert(order);
+// const Order* o = orders.find(ecrypa::item<0, Order>{}, 42);
+// auto [first, last] = orders.range(ecrypa::item<3, Order>{}, t0, t1);
+// ```
+template<class Outer, class... Indexes>
+class table {
+  static_assert(
+    (... && std::is_same_v<typename Indexes::item_type::outer_type, Outer>),
+    "table: indexes must refer to member handles of `Outer`"
+  );
+  static_assert(
+    (... && bool{Indexes::item_type::is_member}),
+    "table: only members can be indexed"
+  );
+
+ public:
+  using row_id = std::size_t;
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  bool contains(row_id row) const {
+    return row < rows_.size() && rows_[row].has_value();
+  }
+
+  const Outer& operator[](row_id row) const {
+    assert(contains(row));
+    return *rows_[row];
+  }
+
+// if linking into an index throws, the indexes already linked are unlinked
+// and the table is left as before
+  row_id insert(Outer outer) {
+    const bool reused = !free_.empty();
+    row_id row;
+    if(reused) {
+      row = free_.back();
+      rows_[row].emplace(std::move(outer));
+      free_.pop_back();
+    }
+    else {
+      row = rows_.size();
+      rows_.emplace_back(std::move(outer));
+    }
+    std::size_t linked = 0;
+    try {
+      each_index([&] (auto index, auto& state) {
+        if(!reused) state.positions.resize(rows_.size());
+        link(index, state, row);
+        ++linked;
+      });
+    }
+    catch(...) {
+      each_index([&] (auto index, auto& state) {
+        if(linked == 0) return;
+        --linked;
+        unlink(index, state, row);
+      });
+      if(reused) {
+        rows_[row].reset();
+        free_.push_back(row);
+      }
+      else {
+        rows_.pop_back();
+      }
+      throw;
+    }
+    ++size_;
+    return row;
+  }
+
+  void erase(row_id row) {
+    assert(contains(row));
+    each_index([&] (auto index, auto& state) {
+      unlink(index, state, row);
+    });
+    rows_[row].reset();
+    free_.push_back(row);
+    --size_;
+  }
+
+// `f(Outer&)` may modify anything; indexes whose key changed are updated,
+// also if `f` throws
+  template<class F>
+  void update(row_id row, F&& f) {
+    assert(contains(row));
+    auto old_keys = std::make_tuple(
+      typename Indexes::key_type{typename Indexes::item_type{}(*rows_[row])}...
+    );
+    try {
+      std::forward<F>(f)(*rows_[row]);
+    }
+    catch(...) {
+      relink_changed(old_keys, row);
+      throw;
+    }
+    relink_changed(old_keys, row);
+  }
+
+// first row with the given key (any, if several), or nullptr
+  template<class Item, class Key>
+  const Outer* find(Item, const Key& key) const {
+    using Index = index_for<Item>;
+    const row_id* row = Index::find(state_for<Item>().container, key);
+    return row == nullptr ? nullptr : &*rows_[*row];
+  }
+
+// rows with the given key: `[first, last)` of `(key, row_id)` pairs for an
+// ordered index, of row ids for a hash index
+  template<class Item, class Key>
+  auto equal_range(Item, const Key& key) const {
+    using Index = index_for<Item>;
+    return Index::equal_range(state_for<Item>().container, key);
+  }
+
+// `[first, last)` of `(key, row_id)` pairs with `lo <= key <= hi`; requires
+// an ordered index
+  template<class Item, class Key>
+  auto range(Item, const Key& lo, const Key& hi) const {
+    const auto& container = state_for<Item>().container;
+    return std::make_pair(container.lower_bound(lo), container.upper_bound(hi));
+  }
+
+  template<class F>
+  void for_each(F&& f) const {
+    for(row_id row=0; row<rows_.size(); ++row) {
+      if(rows_[row]) f(row, *rows_[row]);
+    }
+  }
+
+ private:
+  template<class Index>
+  struct index_state {
+    typename Index::container_type container;
+    std::vector<typename Index::position_type> positions;// by row id
+  };
+
+  std::vector<std::optional<Outer>> rows_;
+  std::vector<row_id> free_;
+  std::size_t size_ = 0;
+  std::tuple<index_state<Indexes>...> indexes_;
+
+  template<class Item, std::size_t i = 0>
+  static constexpr std::size_t index_position() {
+    static_assert(i < sizeof...(Indexes), "table: no index on this member");
+    using Index = std::tuple_element_t<i, std::tuple<Indexes...>>;
+    if constexpr(std::is_same_v<typename Index::item_type, Item>) return i;
+    else return index_position<Item, i + 1>();
+  }
+
+  template<class Item>
+  using index_for =
+    std::tuple_element_t<index_position<Item>(), std::tuple<Indexes...>>;
+
+  template<class Item>
+  const auto& state_for() const {
+    return std::get<index_position<Item>()>(indexes_);
+  }
+
+  template<class F>
+  void each_index(F&& f) {
+    std::apply([&] (auto&... states) {
+      (..., f(Indexes{}, states));
+    }, indexes_);
+  }
+
+  template<class OldKeys>
+  void relink_changed(const OldKeys& old_keys, row_id row) {
+    relink_changed(old_keys, row, std::index_sequence_for<Indexes...>{});
+  }
+
+  template<class OldKeys, std::size_t... is>
+  void relink_changed(
+    const OldKeys& old_keys, row_id row, std::index_sequence<is...>
+  ) {
+    (..., relink_if_changed(
+      Indexes{}, std::get<is>(indexes_), std::get<is>(old_keys), row
+    ));
+  }
+
+  template<class Index>
+  void relink_if_changed(
+    Index,
+    index_state<Index>& state,
+    const typename Index::key_type& old,
+    row_id row
+  ) {
+    using Item = typename Index::item_type;
+    if(old == Item{}(*rows_[row])) return;
+    Index::unlink(state.container, state.positions, row, old);
+    link(Index{}, state, row);
+  }
+
+  template<class Index>
+  void link(Index, index_state<Index>& state, row_id row) {
+    using Item = typename Index::item_type;
+    Index::link(state.container, state.positions, row, Item{}(*rows_[row]));
+  }
+
+  template<class Index>
+  void unlink(Index, index_state<Index>& state, row_id row) {
+    using Item = typename Index::item_type;
+    Index::unlink(state.container, state.positions, row, Item{}(*rows_[row]));
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <ecrypa/v0/layout.hpp>
+#include <ecrypa/v0/msgpack.hpp>
+#include <ecrypa/v0/names.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Type-erased operations on one annotated type, keyed by its `fingerprint`.
+// Messages are in the MessagePack encoding of `encode_msgpack`.
+struct type_entry {
+  std::uint64_t fingerprint;
+  std::string_view name;
+  void* (*construct)();
+  void (*destroy)(void*);
+  void (*decode)(std::string_view message, void* outer);
+  void (*encode)(std::string& out, const void* outer, msgpack_mode mode);
+};
+
+class type_registry_error : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// an object constructed through a `type_entry`
+using type_erased_ptr = std::unique_ptr<void, void (*)(void*)>;
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
+
+namespace ecrypa::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class Outer>
+void* construct_thunk() { return new Outer{}; }
+
+template<class Outer>
+void destroy_thunk(void* outer) { delete static_cast<Outer*>(outer); }
+
+template<class Outer>
+void decode_thunk(std::string_view message, void* outer) {
+  decode_msgpack(message, *static_cast<Outer*>(outer));
+}
+
+template<class Outer>
+void encode_thunk(std::string& out, const void* outer, msgpack_mode mode) {
+  encode_msgpack(out, *static_cast<const Outer*>(outer), mode);
+}
+
+template<class... Outers>
+constexpr bool distinct_fingerprints() {
+  constexpr std::uint64_t fps[] = {0, fingerprint<Outers>...};
+  for(std::size_t i=1; i<=sizeof...(Outers); ++i) {
+    for(std::size_t j=1; j<i; ++j) {
+      if(fps[i] == fps[j]) return false;
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// ecrypa::detail
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<class Outer>
+constexpr type_entry make_type_entry() {
+  return {
+    fingerprint<Outer>,
+    type_name<Outer>(),
+    &detail::construct_thunk<Outer>,
+    &detail::destroy_thunk<Outer>,
+    &detail::decode_thunk<Outer>,
+    &detail::encode_thunk<Outer>
+  };
+}
+
+// Maps fingerprints of annotated types to their `type_entry`, for dispatch
+// on a fingerprint received with a message:
+// ```
+// auto registry = ecrypa::type_registry::of<Order, Fill, Cancel>();
+// ecrypa::type_erased_ptr msg = registry.decode(fp, payload);
+// ```
+// Lookup is a single probe into an open-addressing table in the common case;
+// fingerprints are hashes already, so their low bits index it directly.
+// Not synchronized: register everything before looking up concurrently.
+class type_registry {
+ public:
+  template<class... Outers>
+  static type_registry of() {
+    static_assert(
+      detail::distinct_fingerprints<Outers...>(),
+      "type_registry: fingerprints repeat, a type is listed twice"
+    );
+    type_registry ret;
+    (..., ret.add<Outers>());
+    return ret;
+  }
+
+// the registry filled by `register_type`
+  static type_registry& global() {
+    static type_registry ret;
+    return ret;
+  }
+
+  template<class Outer>
+  void add() { add(make_type_entry<Outer>()); }
+
+// adding the same type again is a no-op; a different type with the same
+// fingerprint throws `type_registry_error`
+  void add(const type_entry& entry) {
+    if(const type_entry* e = find(entry.fingerprint)) {
+      if(e->name == entry.name) return;
+      throw type_registry_error(
+        "type_registry: fingerprint of " + std::string(entry.name)
+        + " collides with " + std::string(e->name)
+      );
+    }
+    entries_.push_back(entry);
+    if(2 * entries_.size() > slots_.size()) {
+      rehash(slots_.empty() ? 16 : 2 * slots_.size());
+    }
+    else {
+      insert(entries_.size() - 1);
+    }
+  }
+
+  std::size_t size() const { return entries_.size(); }
+
+  const type_entry* find(std::uint64_t fp) const {
+    if(slots_.empty()) return nullptr;
+    const std::size_t mask = slots_.size() - 1;
+    for(std::size_t i = fp & mask;; i = (i + 1) & mask) {
+      const std::uint32_t slot = slots_[i];
+      if(!slot) return nullptr;
+      if(entries_[slot - 1].fingerprint == fp) return &entries_[slot - 1];
+    }
+  }
+
+// like `find`, but throws `type_registry_error` for unknown fingerprints
+  const type_entry& at(std::uint64_t fp) const {
+    if(const type_entry* e = find(fp)) return *e;
+    throw type_registry_error(
+      "type_registry: unknown fingerprint " + std::to_string(fp)
+    );
+  }
+
+// constructs the type of fingerprint `fp` and decodes `message` into it
+  type_erased_ptr decode(std::uint64_t fp, std::string_view message) const {
+    const type_entry& e = at(fp);
+    type_erased_ptr ret{e.construct(), e.destroy};
+    e.decode(message, ret.get());
+    return ret;
+  }
+
+  const std::vector<type_entry>& entries() const { return entries_; }
+
+ private:
+  std::vector<type_entry> entries_;
+// index into `entries_` + 1, or 0 for empty slots; size is a power of two
+  std::vector<std::uint32_t> slots_;
+
+  void insert(std::size_t index) {
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t i = entries_[index].fingerprint & mask;
+    while(slots_[i]) i = (i + 1) & mask;
+    slots_[i] = std::uint32_t(index + 1);
+  }
+
+  void rehash(std::size_t size) {
+    slots_.assign(size, 0);
+    for(std::size_t i=0; i<entries_.size(); ++i) insert(i);
+  }
+};
+
+// Adds `Outer` to `type_registry::global()` during static initialization:
+// ```
+// static const ecrypa::register_type<Order> order_type;
+// ```
+template<class Outer>
+struct register_type {
+  register_type() { type_registry::global().add<Outer>(); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
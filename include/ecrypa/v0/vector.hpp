@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <ecrypa/v0/relocate.hpp>
+
+namespace ecrypa {
+inline namespace v0 {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A contiguous sequence like `std::vector`, which relocates elements with
+// `uninitialized_relocate_n`: trivially relocatable elements move with one
+// `memcpy` when the vector grows, and with one `memmove` past `insert` and
+// `erase`, instead of element-wise move and destroy.
+template<class T>
+class vector {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  vector() = default;
+
+// the constructors below delegate, so the destructor releases what they built
+// if they throw
+  explicit vector(size_type n) : vector() { resize(n); }
+
+  vector(std::initializer_list<T> il) : vector() {
+    reserve(il.size());
+    for(const T& t : il) push_back(t);
+  }
+
+  vector(const vector& other) : vector() {
+    reserve(other.size_);
+    std::uninitialized_copy_n(other.data_, other.size_, data_);
+    size_ = other.size_;
+  }
+
+  vector(vector&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)},
+      size_{std::exchange(other.size_, 0)},
+      capacity_{std::exchange(other.capacity_, 0)}
+  {}
+
+  vector& operator=(const vector& other) {
+    if(this != &other) vector(other).swap(*this);
+    return *this;
+  }
+
+  vector& operator=(vector&& other) noexcept {
+    vector(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  ~vector() {
+    clear();
+    deallocate(data_, capacity_);
+  }
+
+  void swap(vector& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+  }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  size_type size() const { return size_; }
+  size_type capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+  T& operator[](size_type i) { return data_[i]; }
+  const T& operator[](size_type i) const { return data_[i]; }
+  T& front() { return data_[0]; }
+  const T& front() const { return data_[0]; }
+  T& back() { return data_[size_ - 1]; }
+  const T& back() const { return data_[size_ - 1]; }
+
+  void reserve(size_type n) {
+    if(n <= capacity_) return;
+    buffer b{n};
+    uninitialized_relocate_n(data_, size_, b.get());
+    adopt(b);
+  }
+
+  void shrink_to_fit() {
+    if(size_ == capacity_) return;
+    buffer b{size_};
+    uninitialized_relocate_n(data_, size_, b.get());
+    adopt(b);
+  }
+
+  void resize(size_type n) {
+    if(n < size_) {
+      std::destroy(data_ + n, data_ + size_);
+    }
+    else {
+      reserve(n);
+      std::uninitialized_value_construct(data_ + size_, data_ + n);
+    }
+    size_ = n;
+  }
+
+  void clear() {
+    std::destroy_n(data_, size_);
+    size_ = 0;
+  }
+
+  template<class... Args>
+  T& emplace_back(Args&&... args) {
+    if(size_ == capacity_) {
+      // construct first: `args` may refer into the elements
+      buffer b{grown()};
+      T* t = ::new(static_cast<void*>(b.get() + size_))
+        T(std::forward<Args>(args)...);
+      try {
+        uninitialized_relocate_n(data_, size_, b.get());
+      }
+      catch(...) {
+        t->~T();
+        throw;
+      }
+      adopt(b);
+    }
+    else {
+      ::new(static_cast<void*>(data_ + size_)) T(std::forward<Args>(args)...);
+    }
+    return data_[size_++];
+  }
+
+  void push_back(const T& t) { emplace_back(t); }
+  void push_back(T&& t) { emplace_back(std::move(t)); }
+
+  void pop_back() { data_[--size_].~T(); }
+
+  template<class... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    const size_type i = size_type(pos - data_);
+    if(i == size_) {
+      emplace_back(std::forward<Args>(args)...);
+      return data_ + i;
+    }
+    if constexpr(is_trivially_relocatable_v<T>) {
+      // construct first: `args` may refer into the elements
+      alignas(T) unsigned char buffer[sizeof(T)];
+      T* t = ::new(static_cast<void*>(buffer)) T(std::forward<Args>(args)...);
+      if(size_ == capacity_) {
+        try {
+          reserve(grown());
+        }
+        catch(...) {
+          t->~T();
+          throw;
+        }
+      }
+      std::memmove(
+        static_cast<void*>(data_ + i + 1), data_ + i, (size_ - i) * sizeof(T)
+      );
+      uninitialized_relocate_n(t, 1, data_ + i);
+      ++size_;
+      return data_ + i;
+    }
+    else {
+      T t(std::forward<Args>(args)...);
+      emplace_back(std::move(back()));
+      std::move_backward(data_ + i, data_ + size_ - 2, data_ + size_ - 1);
+      data_[i] = std::move(t);
+      return data_ + i;
+    }
+  }
+
+  iterator insert(const_iterator pos, const T& t) { return emplace(pos, t); }
+  iterator insert(const_iterator pos, T&& t) {
+    return emplace(pos, std::move(t));
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    T* f = data_ + (first - data_);
+    T* l = data_ + (last - data_);
+    if constexpr(is_trivially_relocatable_v<T>) {
+      std::destroy(f, l);
+      std::memmove(
+        static_cast<void*>(f), l, size_type(data_ + size_ - l) * sizeof(T)
+      );
+    }
+    else {
+      T* new_end = std::move(l, data_ + size_, f);
+      std::destroy(new_end, data_ + size_);
+    }
+    size_ -= size_type(l - f);
+    return f;
+  }
+
+ private:
+  T* data_ = nullptr;
+  size_type size_ = 0;
+  size_type capacity_ = 0;
+
+  size_type grown() const { return capacity_ ? 2 * capacity_ : 4; }
+
+// storage for `size` elements, freed on unwind unless adopted
+  class buffer {
+   public:
+    explicit buffer(size_type size)
+      : data_{size ? allocate(size) : nullptr}, size_{size} {}
+
+    buffer(const buffer&) = delete;
+    buffer& operator=(const buffer&) = delete;
+
+    ~buffer() { deallocate(data_, size_); }
+
+    T* get() const { return data_; }
+    size_type size() const { return size_; }
+    T* release() { return std::exchange(data_, nullptr); }
+
+   private:
+    T* data_;
+    size_type size_;
+  };
+
+// replaces the storage by `b`, into which the elements have been relocated
+  void adopt(buffer& b) {
+    deallocate(data_, capacity_);
+    capacity_ = b.size();
+    data_ = b.release();
+  }
+
+  static T* allocate(size_type n) { return std::allocator<T>{}.allocate(n); }
+
+  static void deallocate(T* p, size_type n) {
+    if(p) std::allocator<T>{}.deallocate(p, n);
+  }
+};
+
+template<class T>
+bool operator==(const vector<T>& lhs, const vector<T>& rhs) {
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template<class T>
+bool operator!=(const vector<T>& lhs, const vector<T>& rhs) {
+  return !(lhs == rhs);
+}
+
+template<class T>
+struct is_trivially_relocatable<vector<T>> : std::true_type {};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}// inline v0
+}// ecrypa
@@ -0,0 +1,103 @@
+// `binary_log` keeps every record of threads that exit before `poll`, and
+// frees their rings once drained: the memory held by the rings stays bounded
+// while logging threads come and go
+
+#include <ecrypa/v0/binary_log.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <string>
+#include <thread>
+
+// allocations of at least `ring_bytes` (the rings) currently live
+static constexpr std::size_t ring_bytes = std::size_t{1} << 16;
+static std::atomic<long> live_rings{0};
+
+// each allocation is preceded by a header holding its size
+static constexpr std::size_t header = sizeof(std::max_align_t);
+
+static void* allocate(std::size_t size) {
+  if(size > std::numeric_limits<std::size_t>::max() - header) {
+    throw std::bad_alloc();
+  }
+  auto p = static_cast<std::size_t*>(std::malloc(size + header));
+  if(!p) throw std::bad_alloc();
+  *p = size;
+  if(size >= ring_bytes) ++live_rings;
+  return reinterpret_cast<char*>(p) + header;
+}
+
+static void deallocate(void* q) {
+  if(!q) return;
+  auto p = reinterpret_cast<std::size_t*>(static_cast<char*>(q) - header);
+  if(*p >= ring_bytes) --live_rings;
+  std::free(p);
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { deallocate(p); }
+
+struct Fill {
+  int id;
+  double px;
+
+  template<class A> friend constexpr auto annotate(A a, Fill* /*adl*/) {
+    return a(
+      a(&Fill::id, "id"),
+      a(&Fill::px, "px")
+    );
+  }
+};
+
+static bool check_thread_churn() {
+  ecrypa::binary_log logger{ring_bytes};
+  std::size_t records = 0;
+  long peak = 0;
+  for(int i=0; i<200; ++i) {
+    std::thread([&logger, i] {
+      logger.log(Fill{i, 1.5});
+      logger.log(Fill{i, 2.5});
+    }).join();
+    peak = std::max(peak, live_rings.load());
+    if(i % 4 == 0) records += logger.poll([] (auto, auto) {});
+  }
+  records += logger.poll([] (auto, auto) {});
+
+  const bool ok = records == 400 && peak <= 4 && live_rings == 0;
+  if(!ok) {
+    std::printf(
+      "binary_log: %zu records, %ld rings at peak, %ld left\n",
+      records, peak, live_rings.load()
+    );
+  }
+  return ok;
+}
+
+static bool check_live_thread_keeps_ring() {
+  ecrypa::binary_log logger{ring_bytes};
+  logger.log(Fill{1, 1});
+  std::string text;
+  logger.format(text);
+  logger.log(Fill{2, 2});
+  logger.format(text);
+
+  const bool ok = text == "Fill{id=1, px=1}\nFill{id=2, px=2}\n"
+    && live_rings == 1;
+  if(!ok) std::printf("binary_log: live thread lost its ring\n");
+  return ok;
+}
+
+int main() {
+  bool ok = check_thread_churn();
+  ok = check_live_thread_keeps_ring() && ok;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
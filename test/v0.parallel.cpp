@@ -0,0 +1,116 @@
+// `each_member_par` runs every member exactly once, inline or on the pool,
+// rethrows the first exception, and waits for queued tasks even when
+// queueing one fails (allocations are failed one by one)
+
+#include <ecrypa/v0/parallel.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the `countdown`th allocation from now throws `std::bad_alloc`
+static std::atomic<int> countdown{0};
+
+void* operator new(std::size_t size) {
+  if(countdown.load() > 0 && countdown.fetch_sub(1) == 1) {
+    throw std::bad_alloc();
+  }
+  if(void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+struct Columns {
+  std::vector<char> a;
+  std::vector<char> b;
+  std::string c;
+  std::vector<char> d;
+  int e;
+
+  template<class A> friend constexpr auto annotate(A a, Columns* /*adl*/) {
+    return a(
+      a(&Columns::a, "a"),
+      a(&Columns::b, "b"),
+      a(&Columns::c, "c"),
+      a(&Columns::d, "d"),
+      a(&Columns::e, "e")
+    );
+  }
+};
+
+static Columns make_columns() {
+  return {
+    std::vector<char>(100), std::vector<char>(10), std::string(100, 'c'),
+    std::vector<char>(1000), 1
+  };
+}
+
+static bool check_runs_each_member_once() {
+  ecrypa::task_pool pool{3};
+  const Columns columns = make_columns();
+  bool ok = true;
+  for(std::size_t threshold : {0, 64, 1 << 20}) {
+    std::array<std::atomic<int>, 5> runs{};
+    ecrypa::each_member_par(columns, [&] (auto m) {
+      ++runs[m.idx];
+    }, threshold, pool);
+    for(auto& r : runs) ok = ok && r == 1;
+  }
+  if(!ok) std::printf("each_member_par: members not run once\n");
+  return ok;
+}
+
+static bool check_rethrows() {
+  ecrypa::task_pool pool{2};
+  const Columns columns = make_columns();
+  std::atomic<int> runs{0};
+  bool thrown = false;
+  try {
+    ecrypa::each_member_par(columns, [&] (auto m) {
+      ++runs;
+      if(m.idx == 3) throw std::runtime_error("member");
+    }, 64, pool);
+  }
+  catch(const std::runtime_error&) {
+    thrown = true;
+  }
+  const bool ok = thrown && runs == 5;
+  if(!ok) std::printf("each_member_par: exception not rethrown\n");
+  return ok;
+}
+
+static bool check_failed_submit() {
+  ecrypa::task_pool pool{1};
+  const Columns columns = make_columns();
+  bool ok = true;
+  for(int k=1; k<40; ++k) {
+    std::array<std::atomic<int>, 5> runs{};
+    countdown = k;
+    try {
+      ecrypa::each_member_par(columns, [&] (auto m) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ++runs[m.idx];
+      }, 64, pool);
+    }
+    catch(const std::bad_alloc&) {}
+    countdown = 0;
+    for(auto& r : runs) ok = ok && r <= 1;
+  }
+  if(!ok) std::printf("each_member_par: failed submit\n");
+  return ok;
+}
+
+int main() {
+  bool ok = check_runs_each_member_once();
+  ok = check_rethrows() && ok;
+  ok = check_failed_submit() && ok;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,78 @@
+// `seqlock` readers never see a torn value while a writer updates it, and an
+// update whose function throws publishes nothing and leaves the lock usable
+
+#include <ecrypa/v0/seqlock.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+struct Pair {
+  std::uint64_t a;
+  std::uint32_t b;
+  std::uint64_t c;
+
+  template<class A> friend constexpr auto annotate(A a, Pair* /*adl*/) {
+    return a(
+      a(&Pair::a, "a"),
+      a(&Pair::b, "b"),
+      a(&Pair::c, "c")
+    );
+  }
+};
+
+static bool check_throwing_update() {
+  ecrypa::seqlock<Pair> lock(Pair{1, 2, 3});
+  bool thrown = false;
+  try {
+    lock.update([] (Pair& p) {
+      p.a = 10;
+      throw std::runtime_error("update");
+    });
+  } catch(const std::runtime_error&) {
+    thrown = true;
+  }
+  const Pair before = lock.load();
+  lock.store(ecrypa::item<2, Pair>{}, 30);
+  const Pair after = lock.load();
+
+  const bool ok = thrown
+    && before.a == 1 && before.b == 2 && before.c == 3
+    && after.a == 1 && after.b == 2 && after.c == 30;
+  if(!ok) std::printf("seqlock: throwing update\n");
+  return ok;
+}
+
+static bool check_concurrent() {
+  constexpr std::uint64_t rounds = 200000;
+  ecrypa::seqlock<Pair> lock;
+  std::vector<std::thread> readers;
+  std::vector<char> torn(3, 0);
+  for(std::size_t r=0; r<torn.size(); ++r) {
+    readers.emplace_back([&lock, &torn, r] {
+      for(;;) {
+        const Pair p = lock.load();
+        if(p.a != p.c || std::uint32_t(p.a) != p.b) torn[r] = 1;
+        if(lock.load(ecrypa::item<0, Pair>{}) == rounds) return;
+      }
+    });
+  }
+  for(std::uint64_t i=1; i<=rounds; ++i) {
+    lock.store(Pair{i, std::uint32_t(i), i});
+  }
+  for(auto& reader : readers) reader.join();
+
+  bool ok = true;
+  for(char t : torn) ok = ok && !t;
+  if(!ok) std::printf("seqlock: torn read\n");
+  return ok;
+}
+
+int main() {
+  bool ok = check_throwing_update();
+  ok = check_concurrent() && ok;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
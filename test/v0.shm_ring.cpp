@@ -0,0 +1,98 @@
+// `shm_ring` with several producer processes delivers every record exactly
+// once and in order per producer, through a ring small enough to fill up;
+// the smallest ring holds two records
+
+#include <ecrypa/v0/shm_ring.hpp>
+
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct Tick {
+  std::uint64_t producer;
+  std::uint64_t seq;
+
+  template<class A> friend constexpr auto annotate(A a, Tick* /*adl*/) {
+    return a(
+      a(&Tick::producer, "producer"),
+      a(&Tick::seq, "seq")
+    );
+  }
+};
+
+using multi_ring = ecrypa::shm_ring<Tick, ecrypa::shm_producers::multiple>;
+
+static std::string segment_name(const char* what) {
+  return "/ecrypa_test_" + std::to_string(::getpid()) + "_" + what;
+}
+
+static bool check_smallest() {
+  const std::string name = segment_name("smallest");
+  auto ring = multi_ring::create(name, 1);
+  multi_ring::unlink(name);
+  Tick t{};
+  const bool ok = ring.capacity() == 2
+    && ring.try_push({0, 1}) && ring.try_push({0, 2}) && !ring.try_push({0, 3})
+    && ring.try_pop(t) && t.seq == 1 && ring.try_pop(t) && t.seq == 2
+    && !ring.try_pop(t);
+  if(!ok) std::printf("shm_ring: smallest ring\n");
+  return ok;
+}
+
+static bool check_producers() {
+  constexpr std::uint64_t producers = 4;
+  constexpr std::uint64_t per_producer = 20000;
+  const std::string name = segment_name("producers");
+  auto ring = multi_ring::create(name, 64);
+
+  std::vector<pid_t> children;
+  for(std::uint64_t p=0; p<producers; ++p) {
+    const pid_t pid = ::fork();
+    if(pid == 0) {
+      auto writer = multi_ring::open(name);
+      for(std::uint64_t i=0; i<per_producer; ++i) {
+        while(!writer.try_push({p, i})) ::sched_yield();
+      }
+      ::_exit(EXIT_SUCCESS);
+    }
+    if(pid > 0) children.push_back(pid);
+  }
+
+  std::vector<std::uint64_t> next(producers, 0);
+  bool ordered = true;
+  for(std::uint64_t received=0; received<producers * per_producer;) {
+    Tick t{};
+    if(!ring.try_pop(t)) {
+      ::sched_yield();
+      continue;
+    }
+    ordered = ordered && t.producer < producers && t.seq == next[t.producer];
+    if(t.producer < producers) next[t.producer] = t.seq + 1;
+    ++received;
+  }
+
+  bool exited = children.size() == producers;
+  for(pid_t pid : children) {
+    int status = 0;
+    exited = ::waitpid(pid, &status, 0) == pid && WIFEXITED(status)
+      && WEXITSTATUS(status) == EXIT_SUCCESS && exited;
+  }
+  multi_ring::unlink(name);
+
+  Tick extra{};
+  const bool ok = ordered && exited && !ring.try_pop(extra);
+  if(!ok) std::printf("shm_ring: records lost, repeated or reordered\n");
+  return ok;
+}
+
+int main() {
+  bool ok = check_smallest();
+  ok = check_producers() && ok;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,53 @@
+// `radix_sort` against `std::stable_sort`, for ranges sorted by insertion
+// sort only, by one radix pass, and by several
+
+#include <ecrypa/v0/sort_key.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+#include <vector>
+
+struct Row {
+  int a;
+  unsigned b;
+
+  template<class A> friend constexpr auto annotate(A a, Row* /*adl*/) {
+    return a(
+      a(&Row::a, "a"),
+      a(&Row::b, "b")
+    );
+  }
+};
+
+static bool check(std::size_t size, int spread) {
+  std::mt19937 rng{unsigned(size)};
+  std::vector<Row> rows(size);
+  for(std::size_t i=0; i<size; ++i) {
+    rows[i] = {int(rng() % unsigned(2 * spread + 1)) - spread, unsigned(i)};
+  }
+
+  std::vector<Row> expected = rows;
+  std::stable_sort(expected.begin(), expected.end(), [] (Row l, Row r) {
+    return l.a < r.a;
+  });
+  ecrypa::radix_sort(rows, ecrypa::item<0, Row>{});
+
+  const bool ok = std::equal(
+    rows.begin(), rows.end(), expected.begin(), [] (Row l, Row r) {
+      return std::tie(l.a, l.b) == std::tie(r.a, r.b);
+    }
+  );
+  if(!ok) std::printf("radix_sort: size %zu spread %d\n", size, spread);
+  return ok;
+}
+
+int main() {
+  bool ok = true;
+  for(std::size_t size : {0, 1, 2, 5, 10, 30, 32, 33, 100, 256, 1000, 100000}) {
+    for(int spread : {1, 100, 1 << 30}) ok = check(size, spread) && ok;
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}